@@ -165,6 +165,22 @@ protected def sub (m n : @& Int) : Int := m + (- n)
 instance : Sub Int where
   sub := Int.sub
 
+/--
+Same as `Int.add`, but the first argument is owned. If it is an unshared big number, its
+memory is reused for the result. The compiler (`Lean.IR.ExplicitRC`) replaces `Int.add x y`
+with `Int.addInPlace x y` when `x` is dead after the addition; it is not meant to be used directly.
+-/
+@[extern "lean_int_add_in_place"]
+protected def addInPlace (m : Int) (n : @& Int) : Int := m + n
+
+/-- Same as `Int.sub`, but the first argument is owned. See `Int.addInPlace`. -/
+@[extern "lean_int_sub_in_place"]
+protected def subInPlace (m : Int) (n : @& Int) : Int := m - n
+
+/-- Same as `Int.mul`, but the first argument is owned. See `Int.addInPlace`. -/
+@[extern "lean_int_mul_in_place"]
+protected def mulInPlace (m : Int) (n : @& Int) : Int := m * n
+
 /-- A proof that an `Int` is non-negative. -/
 inductive NonNeg : Int → Prop where
   /-- Sole constructor, proving that `ofNat n` is positive. -/
@@ -99,6 +99,22 @@ protected abbrev casesAuxOn {motive : Nat → Sort u} (t : Nat) (zero : motive 0
 def blt (a b : Nat) : Bool :=
   ble a.succ b
 
+/--
+Same as `Nat.add`, but the first argument is owned. If it is an unshared big number, its
+memory is reused for the result. The compiler (`Lean.IR.ExplicitRC`) replaces `Nat.add x y`
+with `Nat.addInPlace x y` when `x` is dead after the addition; it is not meant to be used directly.
+-/
+@[extern "lean_nat_add_in_place"]
+protected def addInPlace (n : Nat) (m : @& Nat) : Nat := n + m
+
+/-- Same as `Nat.sub`, but the first argument is owned. See `Nat.addInPlace`. -/
+@[extern "lean_nat_sub_in_place"]
+protected def subInPlace (n : Nat) (m : @& Nat) : Nat := n - m
+
+/-- Same as `Nat.mul`, but the first argument is owned. See `Nat.addInPlace`. -/
+@[extern "lean_nat_mul_in_place"]
+protected def mulInPlace (n : Nat) (m : @& Nat) : Nat := n * m
+
 attribute [simp] Nat.zero_le
 attribute [simp] Nat.not_lt_zero
 
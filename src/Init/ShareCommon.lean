@@ -81,6 +81,23 @@ instance : Inhabited (State σ) := ⟨.mk σ⟩
 @[extern "lean_state_sharecommon"]
 def State.shareCommon {σ : @& StateFactory} (s : State σ) (a : α) : α × State σ := (a, s)
 
+/--
+State for `NativeState.shareCommon`. It plays the same role as `State`, but the map and set are
+native open addressing hash tables instead of Lean data structures accessed through a `StateFactory`.
+Thus, visiting an object does not require calling Lean closures nor allocating map nodes.
+The state is updated in place when it is not shared, and copied otherwise.
+-/
+opaque NativeStatePointed : NonemptyType
+abbrev NativeState : Type := NativeStatePointed.type
+instance : Nonempty NativeState := NativeStatePointed.property
+
+@[extern "lean_sharecommon_native_state_mk"]
+opaque NativeState.mk : Unit → NativeState
+instance : Inhabited NativeState := ⟨.mk ()⟩
+
+@[extern "lean_native_state_sharecommon"]
+def NativeState.shareCommon (s : NativeState) (a : α) : α × NativeState := (a, s)
+
 end ShareCommon
 
 class MonadShareCommon (m : Type u → Type v) where
@@ -110,3 +127,12 @@ Remark: it optimizes the number of RC operations, and the strategy for caching r
 -/
 @[extern "lean_sharecommon_quick"]
 def ShareCommon.shareCommon' (a : @& α) : α := a
+
+/--
+Parallel version of `ShareCommon.shareCommon'` for very large values.
+Disjoint parts of `a` are maximally shared by different threads using a common hash-consing table.
+The result is the same as the one produced by `ShareCommon.shareCommon'` regardless of the number of threads.
+Small values are processed sequentially.
+-/
+@[extern "lean_sharecommon_quick_par"]
+def ShareCommon.shareCommonPar' (a : @& α) : α := a
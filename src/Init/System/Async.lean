@@ -0,0 +1,45 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Init.System.IO
+
+set_option linter.missingDocs true
+
+/-!
+Asynchronous I/O primitives implemented using the runtime event loop (`libuv`).
+
+The returned tasks are resolved by the event loop thread when the operation completes.
+In contrast to running blocking operations in `IO.asTask`, pending operations do not occupy a
+thread of the task manager.
+-/
+
+namespace IO
+
+/-- Returns a task that finishes after `ms` milliseconds. -/
+@[extern "lean_uv_sleep"]
+opaque sleepAsync (ms : UInt32) : BaseIO (Task Unit)
+
+namespace FS
+
+/-- Asynchronously reads the entire contents of the binary file `fname`. -/
+@[extern "lean_uv_fs_read_file"]
+opaque readBinFileAsync (fname : @& FilePath) : BaseIO (Task (Except IO.Error ByteArray))
+
+/-- Asynchronously writes `content` to the file `fname`, creating or truncating it. -/
+@[extern "lean_uv_fs_write_file"]
+opaque writeBinFileAsync (fname : @& FilePath) (content : @& ByteArray) : BaseIO (Task (Except IO.Error Unit))
+
+/--
+Asynchronously reads `h` until the end of the stream, e.g. the standard output of a child process.
+
+The contents already buffered by `h` are not returned, so `h` should not have been read from before.
+-/
+@[extern "lean_uv_handle_read_to_end"]
+opaque Handle.readBinToEndAsync (h : @& Handle) : BaseIO (Task (Except IO.Error ByteArray))
+
+end FS
+
+end IO
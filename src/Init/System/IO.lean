@@ -424,6 +424,12 @@ Note that EOF does not actually close a handle, so further reads may block and r
 -/
 @[extern "lean_io_prim_handle_read"] opaque read (h : @& Handle) (bytes : USize) : IO ByteArray
 @[extern "lean_io_prim_handle_write"] opaque write (h : @& Handle) (buffer : @& ByteArray) : IO Unit
+/--
+Write all `buffers` to the handle, in order.
+When the total size is large, the handle is flushed and the buffers are written using a few
+vectored writes (`writev`) instead of one write per buffer.
+-/
+@[extern "lean_io_prim_handle_write_many"] opaque writeMany (h : @& Handle) (buffers : @& Array ByteArray) : IO Unit
 
 /--
 Read text up to (including) the next line break from the handle.
@@ -431,7 +437,15 @@ If the returned string is empty, an end-of-file marker has been reached.
 Note that EOF does not actually close a handle, so further reads may block and return more data.
 -/
 @[extern "lean_io_prim_handle_get_line"] opaque getLine (h : @& Handle) : IO String
+/--
+Read up to `max` lines from the handle, see `Handle.getLine`. Each line includes its line break,
+except possibly the last line of the file.
+If the returned array is empty, an end-of-file marker has been reached.
+-/
+@[extern "lean_io_prim_handle_get_lines"] opaque getLines (h : @& Handle) (max : USize) : IO (Array String)
 @[extern "lean_io_prim_handle_put_str"] opaque putStr (h : @& Handle) (s : @& String) : IO Unit
+/-- Write all strings in `ss` to the handle, in order. See `Handle.writeMany`. -/
+@[extern "lean_io_prim_handle_put_str_many"] opaque putStrMany (h : @& Handle) (ss : @& Array String) : IO Unit
 
 end Handle
 
@@ -513,15 +527,17 @@ def Handle.readToEnd (h : Handle) : IO String := do
 partial def lines (fname : FilePath) : IO (Array String) := do
   let h ← Handle.mk fname Mode.read
   let rec read (lines : Array String) := do
-    let line ← h.getLine
-    if line.length == 0 then
+    let batch ← h.getLines 1024
+    if batch.isEmpty then
       pure lines
-    else if line.back == '\n' then
-      let line := line.dropRight 1
-      let line := if line.back == '\r' then line.dropRight 1 else line
-      read <| lines.push line
     else
-      pure <| lines.push line
+      read <| batch.foldl (init := lines) fun lines line =>
+        if line.back == '\n' then
+          let line := line.dropRight 1
+          let line := if line.back == '\r' then line.dropRight 1 else line
+          lines.push line
+        else
+          lines.push line
   read #[]
 
 def writeBinFile (fname : FilePath) (content : ByteArray) : IO Unit := do
@@ -634,6 +650,15 @@ def readFile (fname : FilePath) : IO String := do
   | some s => return s
   | none => throw <| .userError s!"Tried to read file '{fname}' containing non UTF-8 data."
 
+/--
+Reads the entire contents of the binary file `fname` by mapping it into memory, without copying it.
+The mapping is owned by the returned array, and released when the array is freed.
+Updating the array does not modify the file. The file should not be truncated while the array is alive.
+If the file cannot be mapped (e.g., it is not a regular file, or the platform does not support it),
+its contents are read into memory instead.
+-/
+@[extern "lean_io_mmap_bin_file"] opaque mmapBinFile (fname : @& FilePath) : IO ByteArray
+
 end FS
 
 def withStdin [Monad m] [MonadFinally m] [MonadLiftT BaseIO m] (h : FS.Stream) (x : m α) : m α := do
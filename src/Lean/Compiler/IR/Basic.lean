@@ -210,8 +210,10 @@ inductive Expr where
   | fap (c : FunId) (ys : Array Arg)
   /-- Partial application that creates a `pap` value (aka closure in our nonstandard terminology). -/
   | pap (c : FunId) (ys : Array Arg)
-  /-- Application. `x` must be a `pap` value. -/
-  | ap  (x : VarId) (ys : Array Arg)
+  /-- Application. `x` must be a `pap` value.
+  If `borrow` is `true`, the application does not consume `x`. It is set by the RC pass
+  when `x` is still needed after the application. -/
+  | ap  (x : VarId) (ys : Array Arg) (borrow : Bool)
   /-- Given `x : ty` where `ty` is a scalar type, this operation returns a value of Type `tobject`.
   For small scalar values, the Result is a tagged pointer, and no memory allocation is performed. -/
   | box (ty : IRType) (x : VarId)
@@ -228,7 +230,7 @@ inductive Expr where
 @[export lean_ir_mk_sproj_expr] def mkSProjExpr (n : Nat) (offset : Nat) (x : VarId) : Expr := Expr.sproj n offset x
 @[export lean_ir_mk_fapp_expr]  def mkFAppExpr (c : FunId) (ys : Array Arg) : Expr := Expr.fap c ys
 @[export lean_ir_mk_papp_expr]  def mkPAppExpr (c : FunId) (ys : Array Arg) : Expr := Expr.pap c ys
-@[export lean_ir_mk_app_expr]   def mkAppExpr (x : VarId) (ys : Array Arg) : Expr := Expr.ap x ys
+@[export lean_ir_mk_app_expr]   def mkAppExpr (x : VarId) (ys : Array Arg) : Expr := Expr.ap x ys false
 @[export lean_ir_mk_num_expr]   def mkNumExpr (v : Nat) : Expr := Expr.lit (LitVal.num v)
 @[export lean_ir_mk_str_expr]   def mkStrExpr (v : String) : Expr := Expr.lit (LitVal.str v)
 
@@ -544,7 +546,7 @@ def Expr.alphaEqv (ρ : IndexRenaming) : Expr → Expr → Bool
   | Expr.sproj n₁ o₁ x₁,     Expr.sproj n₂ o₂ x₂     => n₁ == n₂ && o₁ == o₂ && aeqv ρ x₁ x₂
   | Expr.fap c₁ ys₁,         Expr.fap c₂ ys₂         => c₁ == c₂ && aeqv ρ ys₁ ys₂
   | Expr.pap c₁ ys₁,         Expr.pap c₂ ys₂         => c₁ == c₂ && aeqv ρ ys₁ ys₂
-  | Expr.ap x₁ ys₁,          Expr.ap x₂ ys₂          => aeqv ρ x₁ x₂ && aeqv ρ ys₁ ys₂
+  | Expr.ap x₁ ys₁ b₁,       Expr.ap x₂ ys₂ b₂       => aeqv ρ x₁ x₂ && aeqv ρ ys₁ ys₂ && b₁ == b₂
   | Expr.box ty₁ x₁,         Expr.box ty₂ x₂         => ty₁ == ty₂ && aeqv ρ x₁ x₂
   | Expr.unbox x₁,           Expr.unbox x₂           => aeqv ρ x₁ x₂
   | Expr.lit v₁,             Expr.lit v₂             => v₁ == v₂
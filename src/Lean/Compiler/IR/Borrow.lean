@@ -250,7 +250,7 @@ def collectExpr (z : VarId) : Expr → M Unit
   | Expr.fap g xs       => do
     let ps ← getParamInfo (ParamMap.Key.decl g)
     ownVar z *> ownArgsUsingParams xs ps
-  | Expr.ap x ys        => ownVar z *> ownVar x *> ownArgs ys
+  | Expr.ap x ys _      => ownVar z *> ownVar x *> ownArgs ys
   | Expr.pap _ xs       => ownVar z *> ownArgs xs
   | _                   => pure ()
 
@@ -285,9 +285,9 @@ def visitVDeclExpr (x : VarId) (ty : IRType) (e : Expr) (b : FnBody) : M FnBody
     let decl ← getDecl f
     let f := if requiresBoxedVersion env decl then mkBoxedName f else f
     boxArgsIfNeeded ys fun ys => return FnBody.vdecl x ty (Expr.pap f ys) b
-  | Expr.ap f ys =>
+  | Expr.ap f ys borrow =>
     boxArgsIfNeeded ys fun ys =>
-    unboxResultIfNeeded x ty (Expr.ap f ys) b
+    unboxResultIfNeeded x ty (Expr.ap f ys borrow) b
   | _     =>
     return FnBody.vdecl x ty e b
 
@@ -115,7 +115,7 @@ def checkPartialApp (c : FunId) (ys : Array Arg) : M Unit := do
 
 def checkExpr (ty : IRType) : Expr → M Unit
   | Expr.pap f ys           => checkPartialApp f ys *> checkObjType ty -- partial applications should always produce a closure object
-  | Expr.ap x ys            => checkObjVar x *> checkArgs ys
+  | Expr.ap x ys _          => checkObjVar x *> checkArgs ys
   | Expr.fap f ys           => checkFullApp f ys
   | Expr.ctor c ys          => do
     if c.cidx > maxCtorTag && (c.size > 0 || c.usize > 0 || c.ssize > 0) then
@@ -13,6 +13,7 @@ import Lean.Compiler.IR.EmitUtil
 import Lean.Compiler.IR.NormIds
 import Lean.Compiler.IR.SimpCase
 import Lean.Compiler.IR.Boxing
+import Lean.Compiler.IR.EscapeAnalysis
 
 namespace Lean.IR.EmitC
 open ExplicitBoxing (requiresBoxedVersion mkBoxedName isBoxedName)
@@ -25,6 +26,8 @@ structure Context where
   jpMap      : JPParamsMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- Variables bound to constructor objects allocated in the stack frame, see `Decl.stackCtors`. -/
+  stackCtors : VarIdSet := {}
 
 abbrev M := ReaderT Context (EStateM String String)
 
@@ -251,16 +254,31 @@ def getJPParams (j : JoinPointId) : M (Array Param) := do
 def declareVar (x : VarId) (t : IRType) : M Unit := do
   emit (toCType t); emit " "; emit x; emit "; "
 
+def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
+  if usize == 0 then emit ssize
+  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
+  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
+
+def isStackCtor (x : VarId) : M Bool :=
+  return (← read).stackCtors.contains x
+
+def declareStackCtor (x : VarId) (c : CtorInfo) : M Unit := do
+  emit "LEAN_STACK_CTOR("; emit x; emit "_s, "; emit c.size; emit ", "
+  emitCtorScalarSize c.usize c.ssize; emit "); "
+
 def declareParams (ps : Array Param) : M Unit :=
   ps.forM fun p => declareVar p.x p.ty
 
 partial def declareVars : FnBody → Bool → M Bool
-  | e@(FnBody.vdecl x t _ b), d => do
+  | e@(FnBody.vdecl x t v b), d => do
     let ctx ← read
     if isTailCallTo ctx.mainFn e then
       pure d
     else
-      declareVar x t; declareVars b true
+      declareVar x t
+      if let .ctor c _ := v then
+        if (← isStackCtor x) then declareStackCtor x c
+      declareVars b true
   | FnBody.jdecl _ xs _ b,    d => do declareParams xs; declareVars b (d || xs.size > 0)
   | e,                        d => if e.isTerminal then pure d else declareVars e.body d
 
@@ -285,6 +303,9 @@ def emitInc (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
   emitLn ");"
 
 def emitDec (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
+  if (← isStackCtor x) then
+    emit "lean_dec_stack_ctor("; emit x; emitLn ");"
+    return
   emit (if checkRef then "lean_dec" else "lean_dec_ref");
   emit "("; emit x;
   if n != 1 then emit ", "; emit n
@@ -336,11 +357,6 @@ def emitArgs (ys : Array Arg) : M Unit :=
     if i > 0 then emit ", "
     emitArg ys[i]!
 
-def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
-  if usize == 0 then emit ssize
-  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
-  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
-
 def emitAllocCtor (c : CtorInfo) : M Unit := do
   emit "lean_alloc_ctor("; emit c.cidx; emit ", "; emit c.size; emit ", "
   emitCtorScalarSize c.usize c.ssize; emitLn ");"
@@ -353,6 +369,10 @@ def emitCtor (z : VarId) (c : CtorInfo) (ys : Array Arg) : M Unit := do
   emitLhs z;
   if c.size == 0 && c.usize == 0 && c.ssize == 0 then do
     emit "lean_box("; emit c.cidx; emitLn ");"
+  else if (← isStackCtor z) then
+    emit "lean_init_stack_ctor("; emit z; emit "_s, "; emit c.cidx; emit ", "; emit c.size; emit ", "
+    emitCtorScalarSize c.usize c.ssize; emitLn ");"
+    emitCtorSetArgs z ys
   else do
     emitAllocCtor c; emitCtorSetArgs z ys
 
@@ -435,12 +455,12 @@ def emitPartialApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
     let y := ys[i]!
     emit "lean_closure_set("; emit z; emit ", "; emit i; emit ", "; emitArg y; emitLn ");"
 
-def emitApp (z : VarId) (f : VarId) (ys : Array Arg) : M Unit :=
+def emitApp (z : VarId) (f : VarId) (ys : Array Arg) (borrow : Bool) : M Unit :=
   if ys.size > closureMaxArgs then do
     emit "{ lean_object* _aargs[] = {"; emitArgs ys; emitLn "};";
     emitLhs z; emit "lean_apply_m("; emit f; emit ", "; emit ys.size; emitLn ", _aargs); }"
   else do
-    emitLhs z; emit "lean_apply_"; emit ys.size; emit "("; emit f; emit ", "; emitArgs ys; emitLn ");"
+    emitLhs z; emit "lean_apply_"; emit ys.size; emit (if borrow then "_b(" else "("); emit f; emit ", "; emitArgs ys; emitLn ");"
 
 def emitBoxFn (xType : IRType) : M Unit :=
   match xType with
@@ -510,7 +530,7 @@ def emitVDecl (z : VarId) (t : IRType) (v : Expr) : M Unit :=
   | Expr.sproj n o x    => emitSProj z t n o x
   | Expr.fap c ys       => emitFullApp z c ys
   | Expr.pap c ys       => emitPartialApp z c ys
-  | Expr.ap x ys        => emitApp z x ys
+  | Expr.ap x ys b      => emitApp z x ys b
   | Expr.box t x        => emitBox z x t
   | Expr.unbox x        => emitUnbox z t x
   | Expr.isShared x     => emitIsShared z x
@@ -667,7 +687,8 @@ def emitDeclAux (d : Decl) : M Unit := do
           let x := xs[i]!
           emit "lean_object* "; emit x.x; emit " = _args["; emit i; emitLn "];"
       emitLn "_start:";
-      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitFnBody b);
+      let borrowsArg g i := (findEnvDecl env g).any (·.nonEscapingParams.contains i)
+      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs, stackCtors := d.stackCtors borrowsArg }) (emitFnBody b);
       emitLn "}"
     | _ => pure ()
 
@@ -63,6 +63,11 @@ structure Context (llvmctx : LLVM.Context) where
   mainFn     : FunId := default
   mainParams : Array Param := #[]
   llvmmodule : LLVM.Module llvmctx
+  /-- The declarations whose code is emitted into `llvmmodule`, or `none` if it contains the whole module.
+  See `emitLLVMPartitioned`. -/
+  partition? : Option NameSet := none
+  /-- Whether `llvmmodule` defines the globals, the initializer and `main` of the module. -/
+  isMainPartition : Bool := true
 
 structure State (llvmctx : LLVM.Context) where
   var2val : Std.HashMap VarId (LLVM.LLVMType llvmctx × LLVM.Value llvmctx)
@@ -100,6 +105,17 @@ def getDecl (n : Name) : M llvmctx Decl := do
   | some d => pure d
   | none   => throw s!"unknown declaration {n}"
 
+/--
+Return `true` if the declaration `d` of the current Lean module is defined in `llvmmodule`.
+When emitting a partition, the global holding a constant is defined by the main partition,
+and a function by the partition it is assigned to. The other partitions only declare them.
+-/
+def isDefinedHere (d : Decl) : M llvmctx Bool := do
+  let ctx ← read
+  match ctx.partition? with
+  | none    => return true
+  | some ns => return if d.params.isEmpty then ctx.isMainPartition else ns.contains d.name
+
 def constInt8 (n : Nat) : M llvmctx (LLVM.Value llvmctx) :=  do
     LLVM.constInt8 llvmctx (UInt64.ofNat n)
 
@@ -526,7 +542,7 @@ def emitFnDecls : M llvmctx Unit := do
     let decl ← getDecl n
     match getExternNameFor env `c decl.name with
     | some cName => emitExternDeclAux decl cName
-    | none       => emitFnDecl decl (!modDecls.contains n)
+    | none       => emitFnDecl decl (!modDecls.contains n || !(← isDefinedHere decl))
   return ()
 
 def emitLhsSlot_ (x : VarId) : M llvmctx (LLVM.LLVMType llvmctx × LLVM.Value llvmctx) := do
@@ -707,7 +723,7 @@ def emitPartialApp (builder : LLVM.Builder llvmctx) (z : VarId) (f : FunId) (ys
     let yval ← LLVM.buildLoad2 builder yty yslot
     callLeanClosureSetFn builder zval (← constIntUnsigned i) yval
 
-def emitApp (builder : LLVM.Builder llvmctx) (z : VarId) (f : VarId) (ys : Array Arg) : M llvmctx Unit := do
+def emitApp (builder : LLVM.Builder llvmctx) (z : VarId) (f : VarId) (ys : Array Arg) (borrow : Bool) : M llvmctx Unit := do
   if ys.size > closureMaxArgs then do
     let aargs ← buildPrologueAlloca builder (← LLVM.arrayType (← LLVM.voidPtrType llvmctx) (UInt64.ofNat ys.size)) "aargs"
     for i in List.range ys.size do
@@ -725,7 +741,7 @@ def emitApp (builder : LLVM.Builder llvmctx) (z : VarId) (f : VarId) (ys : Array
     emitLhsSlotStore builder z zv
   else do
 
-    let fnName :=  s!"lean_apply_{ys.size}"
+    let fnName := if borrow then s!"lean_apply_{ys.size}_b" else s!"lean_apply_{ys.size}"
     let retty ← LLVM.voidPtrType llvmctx
     let args : Array (LLVM.Value llvmctx) := #[← emitLhsVal builder f] ++ (← ys.mapM (fun y => Prod.snd <$> (emitArgVal builder y)))
     -- '1 + ...'. '1' for the fn and 'args' for the arguments
@@ -966,7 +982,7 @@ def emitVDecl (builder : LLVM.Builder llvmctx) (z : VarId) (t : IRType) (v : Exp
   | Expr.sproj n o x    => emitSProj builder z t n o x
   | Expr.fap c ys       => emitFullApp builder z c ys
   | Expr.pap c ys       => emitPartialApp builder z c ys
-  | Expr.ap x ys        => emitApp builder z x ys
+  | Expr.ap x ys b      => emitApp builder z x ys b
   | Expr.box t x        => emitBox builder z x t
   | Expr.unbox x        => emitUnbox builder z t x
   | Expr.isShared x     => emitIsShared builder z x
@@ -1239,6 +1255,9 @@ def emitDecl (mod : LLVM.Module llvmctx) (builder : LLVM.Builder llvmctx) (d : D
 def emitFns (mod : LLVM.Module llvmctx) (builder : LLVM.Builder llvmctx) : M llvmctx Unit := do
   let env ← getEnv
   let decls := getDecls env
+  let decls := match (← read).partition? with
+    | some ns => decls.filter (ns.contains ·.name)
+    | none    => decls
   decls.reverse.forM (emitDecl mod builder)
 
 def callIODeclInitFn (builder : LLVM.Builder llvmctx)
@@ -1573,8 +1592,36 @@ def main : M llvmctx Unit := do
   emitFnDecls
   let builder ← LLVM.createBuilderInContext llvmctx
   emitFns (← getLLVMModule) builder
-  emitInitFn (← getLLVMModule) builder
-  emitMainFnIfNeeded (← getLLVMModule) builder
+  if (← read).isMainPartition then
+    emitInitFn (← getLLVMModule) builder
+    emitMainFnIfNeeded (← getLLVMModule) builder
+
+/-- Rough size of the code generated for `d`, used to balance partitions. -/
+partial def declWeight (d : Decl) : Nat :=
+  match d with
+  | .fdecl (body := b) .. => go b
+  | .extern .. => 0
+where
+  go : FnBody → Nat
+    | .case _ _ _ alts => alts.foldl (fun n alt => n + go alt.body) 1
+    | .jdecl _ _ v b   => 1 + go v + go b
+    | b                => if b.isTerminal then 1 else 1 + go b.body
+
+/--
+Split the declarations of the current module into (at most) `n` partitions of roughly equal weight.
+Declarations are assigned greedily, heaviest first, to the lightest partition.
+-/
+def partitionDecls (decls : List Decl) (n : Nat) : Array NameSet := Id.run do
+  let n := max n 1
+  let decls := decls.toArray.map (fun d => (d.name, declWeight d)) |>.qsort (fun a b => a.2 > b.2)
+  let mut parts : Array (NameSet × Nat) := Array.mkArray n ({}, 0)
+  for (declName, w) in decls do
+    let mut lightest := 0
+    for i in [1:n] do
+      if parts[i]!.2 < parts[lightest]!.2 then
+        lightest := i
+    parts := parts.modify lightest fun (ns, total) => (ns.insert declName, total + w)
+  return parts.map (·.1)
 end EmitLLVM
 
 def getLeanHBcPath : IO System.FilePath := do
@@ -1594,6 +1641,37 @@ partial def getModuleFunctions (mod : LLVM.Module llvmctx) : IO (Array (LLVM.Val
     else go (← LLVM.getNextFunction v) (acc.push v)
   go (← LLVM.getFirstFunction mod) #[]
 
+/--
+Link the runtime (`lean.h.bc`) into `mod`, making its definitions internal, and verify the result.
+-/
+def linkLeanRuntime (mod : LLVM.Module llvmctx) : IO Unit := do
+  let membuf ← LLVM.createMemoryBufferWithContentsOfFile (← getLeanHBcPath).toString
+  let modruntime ← LLVM.parseBitcode llvmctx membuf
+  /- It is important that we extract the names here because
+     pointers into modruntime get invalidated by linkModules -/
+  let runtimeGlobals ← (← getModuleGlobals modruntime).mapM (·.getName)
+  let filter func := do
+    -- | Do not insert internal linkage for
+    -- intrinsics such as `@llvm.umul.with.overflow.i64` which clang generates, and also
+    -- for declarations such as `lean_inc_ref_cold` which are externally defined.
+    if (← LLVM.isDeclaration func) then
+      return none
+    else
+      return some (← func.getName)
+  let runtimeFunctions ← (← getModuleFunctions modruntime).filterMapM filter
+  LLVM.linkModules (dest := mod) (src := modruntime)
+  -- Mark every global and function as having internal linkage.
+  for name in runtimeGlobals do
+    let some global ← LLVM.getNamedGlobal mod name
+       | throw <| IO.Error.userError s!"ERROR: linked module must have global from runtime module: '{name}'"
+    LLVM.setLinkage global LLVM.Linkage.internal
+  for name in runtimeFunctions do
+    let some fn ← LLVM.getNamedFunction mod name
+       | throw <| IO.Error.userError s!"ERROR: linked module must have function from runtime module: '{name}'"
+    LLVM.setLinkage fn LLVM.Linkage.internal
+  if let some err ← LLVM.verifyModule mod then
+    throw <| .userError err
+
 /--
 `emitLLVM` is the entrypoint for the lean shell to code generate LLVM.
 -/
@@ -1607,33 +1685,60 @@ def emitLLVM (env : Environment) (modName : Name) (filepath : String) : IO Unit
   let out? ← ((EmitLLVM.main (llvmctx := llvmctx)).run initState).run emitLLVMCtx
   match out? with
   | .ok _ => do
-         let membuf ← LLVM.createMemoryBufferWithContentsOfFile (← getLeanHBcPath).toString
-         let modruntime ← LLVM.parseBitcode llvmctx membuf
-         /- It is important that we extract the names here because
-            pointers into modruntime get invalidated by linkModules -/
-         let runtimeGlobals ← (← getModuleGlobals modruntime).mapM (·.getName)
-         let filter func := do
-           -- | Do not insert internal linkage for
-           -- intrinsics such as `@llvm.umul.with.overflow.i64` which clang generates, and also
-           -- for declarations such as `lean_inc_ref_cold` which are externally defined.
-           if (← LLVM.isDeclaration func) then
-             return none
-           else
-             return some (← func.getName)
-         let runtimeFunctions ← (← getModuleFunctions modruntime).filterMapM filter
-         LLVM.linkModules (dest := emitLLVMCtx.llvmmodule) (src := modruntime)
-         -- Mark every global and function as having internal linkage.
-         for name in runtimeGlobals do
-           let some global ← LLVM.getNamedGlobal emitLLVMCtx.llvmmodule name
-              | throw <| IO.Error.userError s!"ERROR: linked module must have global from runtime module: '{name}'"
-           LLVM.setLinkage global LLVM.Linkage.internal
-         for name in runtimeFunctions do
-           let some fn ← LLVM.getNamedFunction emitLLVMCtx.llvmmodule name
-              | throw <| IO.Error.userError s!"ERROR: linked module must have function from runtime module: '{name}'"
-           LLVM.setLinkage fn LLVM.Linkage.internal
-         if let some err ← LLVM.verifyModule emitLLVMCtx.llvmmodule then
-           throw <| .userError err
+         linkLeanRuntime emitLLVMCtx.llvmmodule
          LLVM.writeBitcodeToFile emitLLVMCtx.llvmmodule filepath
          LLVM.disposeModule emitLLVMCtx.llvmmodule
   | .error err => throw (IO.Error.userError err)
+
+/--
+Emit the declarations in `partition` into a fresh LLVM context, then optimize the result and write it
+to the object file `objPath`.
+-/
+def emitLLVMPartition (env : Environment) (modName : Name) (partition : NameSet) (isMainPartition : Bool)
+    (objPath : String) : IO Unit := do
+  let llvmctx ← LLVM.createContext
+  let module ← LLVM.createModule llvmctx modName.toString
+  let emitLLVMCtx : EmitLLVM.Context llvmctx :=
+    { env, modName, llvmmodule := module, partition? := some partition, isMainPartition }
+  let initState := { var2val := default, jp2bb := default : EmitLLVM.State llvmctx}
+  let out? ← ((EmitLLVM.main (llvmctx := llvmctx)).run initState).run emitLLVMCtx
+  match out? with
+  | .ok _ => do
+    linkLeanRuntime module
+    let triple ← LLVM.getDefaultTargetTriple
+    let target ← LLVM.getTargetFromTriple (ctx := llvmctx) triple
+    let tm ← LLVM.createTargetMachine target triple "" ""
+    let pmb ← LLVM.createPassManagerBuilder (ctx := llvmctx)
+    pmb.setOptLevel 3
+    let pm ← LLVM.createPassManager
+    pmb.populateModulePassManager pm
+    LLVM.runPassManager pm module
+    LLVM.targetMachineEmitToFile tm module objPath LLVM.CodegenFileType.ObjectFile
+    LLVM.disposePassManager pm
+    LLVM.disposePassManagerBuilder pmb
+    LLVM.disposeTargetMachine tm
+    LLVM.disposeModule module
+  | .error err => throw (IO.Error.userError err)
+
+/--
+Variant of `emitLLVM` for large modules. The declarations of the module are split into `numPartitions`
+partitions, which are emitted, optimized and code generated in parallel, each in its own LLVM context.
+Partition `i` is written to the object file `{filepath}.{i}.o`.
+Partition `0` also contains the globals, the initializer and `main`; the other partitions refer to
+them, and to each other's functions, through external declarations. Thus, the object files can be linked
+together in place of the one obtained by compiling the bitcode file produced by `emitLLVM`.
+-/
+@[export lean_ir_emit_llvm_partitioned]
+def emitLLVMPartitioned (env : Environment) (modName : Name) (filepath : String) (numPartitions : UInt32) :
+    IO Unit := do
+  LLVM.llvmInitializeTargetInfo
+  let parts := EmitLLVM.partitionDecls (getDecls env) numPartitions.toNat
+  let mut tasks := #[]
+  for i in [0:parts.size] do
+    let objPath := s!"{filepath}.{i}.o"
+    tasks := tasks.push (← IO.asTask (prio := .dedicated) <| emitLLVMPartition env modName parts[i]! (i == 0) objPath)
+  -- Wait for all partitions before reporting the first error.
+  let results ← tasks.mapM IO.wait
+  for r in results do
+    if let .error e := r then throw e
 end Lean.IR
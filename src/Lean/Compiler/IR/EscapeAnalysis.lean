@@ -0,0 +1,133 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Lean.Compiler.IR.Basic
+
+/-!
+# Escape analysis for constructor objects
+
+We say a variable `x` introduced by `let x := ctor_i ys` does not escape if its value is only
+inspected (`proj`, `uproj`, `sproj`, `case`), initialized (`uset`, `sset`) and finally consumed by a single `dec x`.
+In particular, `x` is never passed to a join point, stored in another object, returned,
+shared (`inc x`) or reused. It may be passed to a function that borrows the corresponding parameter
+and does not let it escape either (see `Decl.nonEscapingParams`).
+
+The C code generator allocates such objects in the stack frame of the function instead of the heap
+(see `lean_init_stack_ctor` in `lean.h`), and compiles `dec x` into `lean_dec_stack_ctor(x)`,
+which releases the fields of `x`.
+
+This analysis must be performed after the RC and boxing passes.
+-/
+
+namespace Lean.IR.EscapeAnalysis
+
+structure State where
+  /-- Variables introduced by constructor applications. -/
+  candidates : VarIdSet := {}
+  /-- Variables used in a position where they may escape. -/
+  escaping   : VarIdSet := {}
+
+structure Context where
+  /-- `borrowsArg f i` is `true` if `f` borrows its `i`-th argument and does not let it escape. -/
+  borrowsArg : FunId → Nat → Bool := fun _ _ => false
+
+abbrev M := ReaderT Context (StateM State)
+
+@[inline] def escape (x : VarId) : M Unit :=
+  modify fun s => { s with escaping := s.escaping.insert x }
+
+def escapeArgs (ys : Array Arg) : M Unit :=
+  ys.forM fun
+    | .var y      => escape y
+    | .irrelevant => pure ()
+
+def visitExpr : Expr → M Unit
+  | .ctor _ ys        => escapeArgs ys
+  | .reuse x _ _ ys   => escape x *> escapeArgs ys
+  | .reset _ x        => escape x
+  | .fap f ys         => do
+    let ctx ← read
+    let s ← get
+    ys.size.forM fun i => do
+      match ys[i]! with
+      | .var y =>
+        -- only query `borrowsArg` for candidates, it may have to analyze the body of `f`
+        unless s.candidates.contains y && ctx.borrowsArg f i do escape y
+      | .irrelevant => pure ()
+  | .pap _ ys         => escapeArgs ys
+  | .ap x ys _        => escape x *> escapeArgs ys
+  | .box _ x          => escape x
+  | .unbox x          => escape x
+  | .isShared x       => escape x
+  | .proj ..          => pure ()
+  | .uproj ..         => pure ()
+  | .sproj ..         => pure ()
+  | .lit _            => pure ()
+
+partial def visitFnBody : FnBody → M Unit
+  | .vdecl x t v b => do
+    match v with
+    | .ctor c _ =>
+      if t.isObj && c.isRef then
+        modify fun s => { s with candidates := s.candidates.insert x }
+    | _ => pure ()
+    visitExpr v
+    visitFnBody b
+  | .jdecl _ _ v b        => visitFnBody v *> visitFnBody b
+  | .set x _ y b          => escape x *> escapeArgs #[y] *> visitFnBody b
+  | .setTag x _ b         => escape x *> visitFnBody b
+  | .uset _ _ _ b         => visitFnBody b
+  | .sset _ _ _ _ _ b     => visitFnBody b
+  | .inc x _ _ _ b        => escape x *> visitFnBody b
+  | .dec x n _ _ b        => do
+    -- `n > 1` means that `x` has other references
+    if n != 1 then escape x
+    visitFnBody b
+  | .del x b              => escape x *> visitFnBody b
+  | .mdata _ b            => visitFnBody b
+  | .case _ _ _ alts      => alts.forM fun alt => visitFnBody alt.body
+  | .ret x                => escapeArgs #[x]
+  | .jmp _ ys             => escapeArgs ys
+  | .unreachable          => pure ()
+
+end EscapeAnalysis
+
+/--
+Return the indices of the borrowed object parameters of `d` that do not escape `d`.
+Arguments passed to other functions are assumed to escape. Arguments passed to a borrowed parameter of `d` itself
+in recursive calls do not escape if that parameter does not escape either. We compute the greatest such set: starting
+with all borrowed parameters, we remove the escaping ones until the set is stable.
+-/
+def Decl.nonEscapingParams (d : Decl) : Array Nat :=
+  match d with
+  | .fdecl f xs _ b _ => Id.run do
+    let mut current := (Array.range xs.size).filter fun i => xs[i]!.borrow && xs[i]!.ty.isObj
+    -- each iteration but the last one removes at least one index
+    for _ in [0:current.size + 1] do
+      let ps := current
+      let ctx : EscapeAnalysis.Context := { borrowsArg := fun g i => g == f && ps.contains i }
+      let candidates := ps.foldl (init := {}) fun r i => r.insert xs[i]!.x
+      let s := (EscapeAnalysis.visitFnBody b ctx).run { candidates } |>.2
+      current := ps.filter fun i => !s.escaping.contains xs[i]!.x
+      if current.size == ps.size then
+        break
+    return current
+  | .extern .. => #[]
+
+/--
+Return the variables of `d` that are bound to constructor objects that do not escape `d`,
+and can thus be allocated in its stack frame.
+`borrowsArg f i` must only return `true` if `f` borrows its `i`-th argument and does not let it escape,
+see `Decl.nonEscapingParams`.
+-/
+def Decl.stackCtors (d : Decl) (borrowsArg : FunId → Nat → Bool := fun _ _ => false) : VarIdSet :=
+  match d with
+  | .fdecl (body := b) .. =>
+    let s := (EscapeAnalysis.visitFnBody b { borrowsArg }).run {} |>.2
+    s.candidates.fold (init := {}) fun r x => if s.escaping.contains x then r else r.insert x
+  | .extern .. => {}
+
+end Lean.IR
@@ -44,7 +44,7 @@ private def formatExpr : Expr → Format
   | Expr.sproj n o x    => "sproj[" ++ format n ++ ", " ++ format o ++ "] " ++ format x
   | Expr.fap c ys       => format c ++ formatArray ys
   | Expr.pap c ys       => "pap " ++ format c ++ formatArray ys
-  | Expr.ap x ys        => "app " ++ format x ++ formatArray ys
+  | Expr.ap x ys b      => (if b then "app[b] " else "app ") ++ format x ++ formatArray ys
   | Expr.box _ x        => "box " ++ format x
   | Expr.unbox x        => "unbox " ++ format x
   | Expr.lit v          => format v
@@ -47,7 +47,7 @@ private def collectExpr : Expr → Collector
   | Expr.sproj _ _ x    => collectVar x
   | Expr.fap _ ys       => collectArgs ys
   | Expr.pap _ ys       => collectArgs ys
-  | Expr.ap x ys        => collectVar x >> collectArgs ys
+  | Expr.ap x ys _      => collectVar x >> collectArgs ys
   | Expr.box _ x        => collectVar x
   | Expr.unbox x        => collectVar x
   | Expr.lit _          => skip
@@ -142,7 +142,7 @@ private def collectExpr : Expr → Collector
   | Expr.sproj _ _ x    => collectVar x
   | Expr.fap _ ys       => collectArgs ys
   | Expr.pap _ ys       => collectArgs ys
-  | Expr.ap x ys        => collectVar x >> collectArgs ys
+  | Expr.ap x ys _      => collectVar x >> collectArgs ys
   | Expr.box _ x        => collectVar x
   | Expr.unbox x        => collectVar x
   | Expr.lit _          => skip
@@ -202,7 +202,7 @@ def visitExpr (w : Index) : Expr → Bool
   | Expr.sproj _ _ x    => visitVar w x
   | Expr.fap _ ys       => visitArgs w ys
   | Expr.pap _ ys       => visitArgs w ys
-  | Expr.ap x ys        => visitVar w x || visitArgs w ys
+  | Expr.ap x ys _      => visitVar w x || visitArgs w ys
   | Expr.box _ x        => visitVar w x
   | Expr.unbox x        => visitVar w x
   | Expr.lit _          => false
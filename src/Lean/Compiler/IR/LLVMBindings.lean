@@ -329,7 +329,7 @@ opaque createPassManagerBuilder : BaseIO (PassManagerBuilder ctx)
 opaque disposePassManagerBuilder (pmb : PassManagerBuilder ctx) : BaseIO Unit
 
 @[extern "lean_llvm_pass_manager_builder_set_opt_level"]
-opaque PassManagerBuilder.setOptLevel (pmb : PassManagerBuilder ctx) (optLevel : unsigned) : BaseIO Unit
+opaque PassManagerBuilder.setOptLevel (pmb : PassManagerBuilder ctx) (optLevel : UInt32) : BaseIO Unit
 
 @[extern "lean_llvm_pass_manager_builder_populate_module_pass_manager"]
 opaque PassManagerBuilder.populateModulePassManager (pmb : PassManagerBuilder ctx) (pm : PassManager ctx): BaseIO Unit
@@ -128,7 +128,7 @@ def collectExpr : Expr → Collector
   | Expr.sproj _ _ x    => collectVar x
   | Expr.fap _ ys       => collectArgs ys
   | Expr.pap _ ys       => collectArgs ys
-  | Expr.ap x ys        => collectVar x ∘ collectArgs ys
+  | Expr.ap x ys _      => collectVar x ∘ collectArgs ys
   | Expr.box _ x        => collectVar x
   | Expr.unbox x        => collectVar x
   | Expr.lit _          => skip
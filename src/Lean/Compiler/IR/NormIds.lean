@@ -65,7 +65,7 @@ def normExpr : Expr → M Expr
   | Expr.sproj n o x,    m => Expr.sproj n o (normVar x m)
   | Expr.fap c ys,       m => Expr.fap c (normArgs ys m)
   | Expr.pap c ys,       m => Expr.pap c (normArgs ys m)
-  | Expr.ap x ys,        m => Expr.ap (normVar x m) (normArgs ys m)
+  | Expr.ap x ys b,      m => Expr.ap (normVar x m) (normArgs ys m) b
   | Expr.box t x,        m => Expr.box t (normVar x m)
   | Expr.unbox x,        m => Expr.unbox (normVar x m)
   | Expr.isShared x,     m => Expr.isShared (normVar x m)
@@ -143,7 +143,7 @@ def mapExpr (f : VarId → VarId) : Expr → Expr
   | Expr.sproj n o x    => Expr.sproj n o (f x)
   | Expr.fap c ys       => Expr.fap c (mapArgs f ys)
   | Expr.pap c ys       => Expr.pap c (mapArgs f ys)
-  | Expr.ap x ys        => Expr.ap (f x) (mapArgs f ys)
+  | Expr.ap x ys b      => Expr.ap (f x) (mapArgs f ys) b
   | Expr.box t x        => Expr.box t (f x)
   | Expr.unbox x        => Expr.unbox (f x)
   | Expr.isShared x     => Expr.isShared (f x)
@@ -143,6 +143,16 @@ xs.size.fold (init := b) fun i b =>
 private def addIncBeforeConsumeAll (ctx : Context) (xs : Array Arg) (b : FnBody) (liveVarsAfter : LiveVarSet) : FnBody :=
   addIncBeforeAux ctx xs (fun _ => true) b liveVarsAfter
 
+/--
+Return `true` if the closure application `x ys` should not consume `x`.
+This is the case when `x` would have to be incremented before the application anyway, i.e.,
+`x` is live after the application or it is a borrowed reference.
+The runtime only provides borrowed versions of `lean_apply_<n>` for `n ≤ closureMaxArgs`. -/
+private def canBorrowClosure (ctx : Context) (x : VarId) (ys : Array Arg) (liveVarsAfter : LiveVarSet) : Bool :=
+  ys.size ≤ closureMaxArgs &&
+  !ys.contains (Arg.var x) &&
+  (liveVarsAfter.contains x || !mustConsume ctx x)
+
 /-- Add `dec` instructions for parameters that are references, are not alive in `b`, and are not borrow.
    That is, we must make sure these parameters are consumed. -/
 private def addDecForDeadParams (ctx : Context) (ps : Array Param) (b : FnBody) (bLiveVars : LiveVarSet) : FnBody :=
@@ -180,6 +190,35 @@ private def updateVarInfo (ctx : Context) (x : VarId) (t : IRType) (v : Expr) :
 private def addDecIfNeeded (ctx : Context) (x : VarId) (b : FnBody) (bLiveVars : LiveVarSet) : FnBody :=
   if mustConsume ctx x && !bLiveVars.contains x then addDec ctx x b else b
 
+/-- Arithmetic primitives that have a variant taking ownership of the first argument (e.g., `Nat.addInPlace`).
+   The second component is `true` if the primitive is commutative. -/
+private def inPlaceVariant? : FunId → Option (FunId × Bool)
+  | `Nat.add => some (`Nat.addInPlace, true)
+  | `Nat.sub => some (`Nat.subInPlace, false)
+  | `Nat.mul => some (`Nat.mulInPlace, true)
+  | `Int.add => some (`Int.addInPlace, true)
+  | `Int.sub => some (`Int.subInPlace, false)
+  | `Int.mul => some (`Int.mulInPlace, true)
+  | _        => none
+
+/-- Return `true` if `x` is a variable that must be consumed, and it is dead after the current instruction. -/
+private def isDeadOwnedArg (ctx : Context) (bLiveVars : LiveVarSet) : Arg → Bool
+  | Arg.var x      => mustConsume ctx x && !bLiveVars.contains x
+  | Arg.irrelevant => false
+
+/--
+If `f ys` is a big number arithmetic primitive, and one of its arguments is dead after the application,
+use the variant that takes ownership of this argument. At runtime, the variant updates exclusive big
+numbers in place instead of allocating a new one. -/
+private def useInPlaceVariant (ctx : Context) (f : FunId) (ys : Array Arg) (bLiveVars : LiveVarSet) : FunId × Array Arg :=
+  match inPlaceVariant? f with
+  | some (f', comm) =>
+    if ys.size != 2 || ys[0]! == ys[1]! || (findEnvDecl' ctx.env f' ctx.decls).isNone then (f, ys)
+    else if isDeadOwnedArg ctx bLiveVars ys[0]! then (f', ys)
+    else if comm && isDeadOwnedArg ctx bLiveVars ys[1]! then (f', #[ys[1]!, ys[0]!])
+    else (f, ys)
+  | none => (f, ys)
+
 private def processVDecl (ctx : Context) (z : VarId) (t : IRType) (v : Expr) (b : FnBody) (bLiveVars : LiveVarSet) : FnBody × LiveVarSet :=
   let b := match v with
     | (Expr.ctor _ ys)       => addIncBeforeConsumeAll ctx ys (FnBody.vdecl z t v b) bLiveVars
@@ -191,14 +230,20 @@ private def processVDecl (ctx : Context) (z : VarId) (t : IRType) (v : Expr) (b
     | (Expr.uproj _ x)       => FnBody.vdecl z t v (addDecIfNeeded ctx x b bLiveVars)
     | (Expr.sproj _ _ x)     => FnBody.vdecl z t v (addDecIfNeeded ctx x b bLiveVars)
     | (Expr.fap f ys)        =>
+      let (f, ys) := useInPlaceVariant ctx f ys bLiveVars
+      let v  := Expr.fap f ys
       let ps := (getDecl ctx f).params
       let b  := addDecAfterFullApp ctx ys ps b bLiveVars
       let b  := FnBody.vdecl z t v b
       addIncBefore ctx ys ps b bLiveVars
     | (Expr.pap _ ys)        => addIncBeforeConsumeAll ctx ys (FnBody.vdecl z t v b) bLiveVars
-    | (Expr.ap x ys)         =>
-      let ysx := ys.push (Arg.var x) -- TODO: avoid temporary array allocation
-      addIncBeforeConsumeAll ctx ysx (FnBody.vdecl z t v b) bLiveVars
+    | (Expr.ap x ys _)       =>
+      if canBorrowClosure ctx x ys bLiveVars then
+        -- `x` is still needed after the application: use `lean_apply_<n>_b` instead of `inc x; lean_apply_<n>`
+        addIncBeforeConsumeAll ctx ys (FnBody.vdecl z t (Expr.ap x ys true) b) bLiveVars
+      else
+        let ysx := ys.push (Arg.var x) -- TODO: avoid temporary array allocation
+        addIncBeforeConsumeAll ctx ysx (FnBody.vdecl z t v b) bLiveVars
     | (Expr.unbox x)         => FnBody.vdecl z t v (addDecIfNeeded ctx x b bLiveVars)
     | _                      => FnBody.vdecl z t v b  -- Expr.reset, Expr.box, Expr.lit are handled here
   let liveVars := updateLiveVars v bLiveVars
@@ -63,6 +63,14 @@ Assumes the declarations have already been added to the environment using `addDe
 @[extern "lean_compile_decls"]
 opaque compileDecls (env : Environment) (opt : @& Options) (decls : @& List Name) : Except KernelException Environment
 
+/--
+Compile the given blocks of mutual declarations. The result is the same as compiling them one by one using
+`compileDecls`, but when the blocks do not reference each other, their simplification is performed in parallel.
+Assumes the declarations have already been added to the environment using `addDecl`.
+-/
+@[extern "lean_compile_decls_batch"]
+opaque compileDeclsBatch (env : Environment) (opt : @& Options) (declGroups : @& List (List Name)) : Except KernelException Environment
+
 /-- Compile the given declaration, it assumes the declaration has already been added to the environment using `addDecl`. -/
 def compileDecl (env : Environment) (opt : @& Options) (decl : @& Declaration) : Except KernelException Environment :=
   compileDecls env opt (Compiler.getDeclNamesForCodeGen decl)
@@ -460,6 +460,18 @@ def compileDecls (decls : List Name) : CoreM Unit := do
   | Except.error ex =>
     throwKernelException ex
 
+/-- Compile the given blocks of mutual declarations. See `Environment.compileDeclsBatch`. -/
+def compileDeclsBatch (declGroups : List (List Name)) : CoreM Unit := do
+  let opts ← getOptions
+  if compiler.enableNew.get opts then
+    declGroups.forM compileDeclsNew
+  match (← getEnv).compileDeclsBatch opts declGroups with
+  | Except.ok env   => setEnv env
+  | Except.error (KernelException.other msg) =>
+    throwError msg
+  | Except.error ex =>
+    throwKernelException ex
+
 def getDiag (opts : Options) : Bool :=
   diagnostics.get opts
 
@@ -75,13 +75,12 @@ private def lineStartPos (text : FileMap) (line : Nat) : String.Pos :=
 /-- Computes an UTF-8 offset into `text.source`
 from an LSP-style 0-indexed (ln, col) position. -/
 def lspPosToUtf8Pos (text : FileMap) (pos : Lsp.Position) : String.Pos :=
-  let lineStartPos := lineStartPos text pos.line
-  let chr := text.source.utf16PosToCodepointPosFrom pos.character lineStartPos
-  text.source.codepointPosToUtf8PosFrom lineStartPos chr
+  text.codepoints.advanceUtf16 (lineStartPos text pos.line) pos.character
 
 def leanPosToLspPos (text : FileMap) : Lean.Position → Lsp.Position
   | ⟨line, col⟩ =>
-    ⟨line - 1, text.source.codepointPosToUtf16PosFrom col (lineStartPos text (line - 1))⟩
+    let lineStartPos := lineStartPos text (line - 1)
+    ⟨line - 1, (text.codepoints.countFrom lineStartPos (text.codepoints.advance lineStartPos col)).2⟩
 
 def utf8PosToLspPos (text : FileMap) (pos : String.Pos) : Lsp.Position :=
   text.leanPosToLspPos (text.toPosition pos)
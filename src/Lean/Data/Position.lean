@@ -31,6 +31,149 @@ instance : ToExpr Position where
 
 end Position
 
+/--
+Auxiliary index for converting between codepoint indices, UTF-16 offsets, and UTF-8 offsets
+(`String.Pos`) of a string without scanning it from the start.
+It stores the offsets of every `CodepointIndex.stride`-th codepoint, so that each conversion scans
+at most `stride` codepoints.
+-/
+structure CodepointIndex where
+  source  : String
+  /-- `samples[i]` is the offset of the codepoint at index `i * stride`.
+  It is empty if `source` contains only ASCII characters, and `#[0]` if `source` is too small to be
+  worth indexing. -/
+  samples : Array String.Pos
+  /-- `utf16[i]` is the UTF-16 offset of `samples[i]`. -/
+  utf16   : Array Nat
+  deriving Inhabited
+
+namespace CodepointIndex
+
+/-- Number of codepoints between two consecutive samples. -/
+def stride : Nat := 64
+
+/-- Strings with fewer bytes than this are not indexed. -/
+def threshold : Nat := 4096
+
+private def csize16 (c : Char) : Nat :=
+  if c.val ≤ 0xFFFF then 1 else 2
+
+/-- Builds the index for `s`. It is cheap for ASCII strings and strings smaller than `threshold`. -/
+partial def ofString (s : String) : CodepointIndex :=
+  -- `String.length` and `String.utf8ByteSize` are O(1)
+  if s.length == s.utf8ByteSize then
+    { source := s, samples := #[], utf16 := #[] }
+  else if s.utf8ByteSize < threshold then
+    { source := s, samples := #[0], utf16 := #[0] }
+  else
+    let rec loop (i : String.Pos) (n u : Nat) (ps : Array String.Pos) (us : Array Nat) : CodepointIndex :=
+      if s.atEnd i then { source := s, samples := ps, utf16 := us }
+      else
+        let (ps, us) := if n % stride == 0 then (ps.push i, us.push u) else (ps, us)
+        loop (s.next i) (n + 1) (u + csize16 (s.get i)) ps us
+    loop 0 0 0 #[] #[]
+
+/-- Returns the last `i < size` such that `p i`, assuming `p 0` holds and `p` is antitone. -/
+private partial def findLast (p : Nat → Bool) (size : Nat) : Nat :=
+  let rec go (lo hi : Nat) : Nat :=
+    if lo + 1 < hi then
+      let m := (lo + hi) / 2
+      if p m then go m hi else go lo m
+    else lo
+  go 0 size
+
+/-- Index of the last sample that is `≤ pos`. `idx.samples` must not be empty. -/
+private def sampleOf (idx : CodepointIndex) (pos : String.Pos) : Nat :=
+  findLast (fun m => decide (idx.samples[m]! ≤ pos)) idx.samples.size
+
+/-- Number of codepoints and UTF-16 code units between `i` and `pos`.
+Positions past the end of `s` count as one codepoint and one code unit per byte. -/
+private partial def scan (s : String) (pos : String.Pos) (i : String.Pos) (n u : Nat) : Nat × Nat :=
+  if pos ≤ i then (n, u)
+  else scan s pos (s.next i) (n + 1) (u + csize16 (s.get i))
+
+/--
+Returns the offset of the `n`-th codepoint.
+Same as `String.Iterator.nextn ⟨idx.source, 0⟩ n |>.pos`.
+-/
+def toPos (idx : CodepointIndex) (n : Nat) : String.Pos :=
+  if idx.samples.isEmpty then
+    ⟨n⟩
+  else
+    let k := min (n / stride) (idx.samples.size - 1)
+    String.Iterator.nextn ⟨idx.source, idx.samples[k]!⟩ (n - k * stride) |>.pos
+
+/--
+Returns the index of the codepoint at offset `pos`, i.e., the number of codepoints preceding it.
+If `pos` is not a valid position, returns the number of codepoints in `idx.source`.
+-/
+partial def ofPos (idx : CodepointIndex) (pos : String.Pos) : Nat :=
+  let s := idx.source
+  if idx.samples.isEmpty then
+    min pos.byteIdx s.utf8ByteSize
+  else
+    let rec go (i : String.Pos) (c : Nat) : Nat :=
+      if i == pos || s.atEnd i then c
+      else go (s.next i) (c + 1)
+    let k := idx.sampleOf pos
+    go idx.samples[k]! (k * stride)
+
+/-- Returns the UTF-16 offset of `pos`, which must be a valid position. -/
+def utf16OfPos (idx : CodepointIndex) (pos : String.Pos) : Nat :=
+  if idx.samples.isEmpty then
+    pos.byteIdx
+  else
+    let k := idx.sampleOf pos
+    idx.utf16[k]! + (scan idx.source pos idx.samples[k]! 0 0).2
+
+/--
+Returns the number of codepoints and UTF-16 code units between `start` and `pos`,
+where `start` is a valid position `≤ pos`.
+The samples are only used when one of them lies between `start` and `pos`; otherwise scanning
+from `start` is cheaper, e.g., when both are on the same short line.
+-/
+def countFrom (idx : CodepointIndex) (start pos : String.Pos) : Nat × Nat :=
+  if idx.samples.isEmpty then
+    let n := pos.byteIdx - start.byteIdx
+    (n, n)
+  else if pos ≤ idx.source.endPos && start < idx.samples[idx.sampleOf pos]! then
+    (idx.ofPos pos - idx.ofPos start, idx.utf16OfPos pos - idx.utf16OfPos start)
+  else
+    scan idx.source pos start 0 0
+
+/--
+Returns the offset of the `n`-th codepoint after `start`.
+Same as `String.Iterator.nextn ⟨idx.source, start⟩ n |>.pos`.
+-/
+def advance (idx : CodepointIndex) (start : String.Pos) (n : Nat) : String.Pos :=
+  if idx.samples.isEmpty then
+    ⟨start.byteIdx + n⟩
+  else if n < stride || idx.sampleOf start + 1 == idx.samples.size then
+    String.Iterator.nextn ⟨idx.source, start⟩ n |>.pos
+  else
+    idx.toPos (idx.ofPos start + n)
+
+/-- Advances `i` by `n` UTF-16 code units, rounding up to the next codepoint. -/
+private partial def advanceUtf16Aux (s : String) (i : String.Pos) : Nat → String.Pos
+  | 0 => i
+  | n => advanceUtf16Aux s (s.next i) (n - csize16 (s.get i))
+
+/--
+Returns the offset of the codepoint at UTF-16 offset `n` after `start`.
+If `n` is in the middle of a surrogate pair, returns the offset of the following codepoint.
+-/
+def advanceUtf16 (idx : CodepointIndex) (start : String.Pos) (n : Nat) : String.Pos :=
+  if idx.samples.isEmpty then
+    ⟨start.byteIdx + n⟩
+  else if n < stride || idx.sampleOf start + 1 == idx.samples.size then
+    advanceUtf16Aux idx.source start n
+  else
+    let u := idx.utf16OfPos start + n
+    let k := findLast (fun m => decide (idx.utf16[m]! ≤ u)) idx.utf16.size
+    advanceUtf16Aux idx.source idx.samples[k]! (u - idx.utf16[k]!)
+
+end CodepointIndex
+
 /-- Content of a file together with precalculated positions of newlines. -/
 structure FileMap where
   /-- The content of the file. -/
@@ -39,6 +182,8 @@ structure FileMap where
   The first entry is always `0` and the last always the index of the last character.
   In particular, if the last character is a newline, that index will appear twice. -/
   positions : Array String.Pos
+  /-- Index for converting columns of long lines without scanning them from the start. -/
+  codepoints : CodepointIndex := CodepointIndex.ofString source
   deriving Inhabited
 
 class MonadFileMap (m : Type → Type) where
@@ -69,29 +214,26 @@ partial def ofString (s : String) : FileMap :=
   loop 0 1 (#[0])
 
 partial def toPosition (fmap : FileMap) (pos : String.Pos) : Position :=
-  match fmap with
-  | { source := str, positions := ps } =>
-    if ps.size >= 2 && pos <= ps.back then
-      let rec toColumn (i : String.Pos) (c : Nat) : Nat :=
-        if i == pos || str.atEnd i then c
-        else toColumn (str.next i) (c+1)
-      let rec loop (b e : Nat) :=
-        let posB := ps[b]!
-        if e == b + 1 then { line := fmap.getLine b, column := toColumn posB 0 }
-        else
-          let m := (b + e) / 2;
-          let posM := ps.get! m;
-          if pos == posM then { line := fmap.getLine m, column := 0 }
-          else if pos > posM then loop m e
-          else loop b m
-      loop 0 (ps.size -1)
-    else if ps.isEmpty then
-      ⟨0, 0⟩
-    else
-      -- Some systems like the delaborator use synthetic positions without an input file,
-      -- which would violate `toPositionAux`'s invariant.
-      -- Can also happen with EOF errors, which are not strictly inside the file.
-      ⟨fmap.getLastLine, (pos - ps.back).byteIdx⟩
+  let ps  := fmap.positions
+  let idx := fmap.codepoints
+  if ps.size >= 2 && pos <= ps.back then
+    let rec loop (b e : Nat) :=
+      let posB := ps[b]!
+      if e == b + 1 then { line := fmap.getLine b, column := (idx.countFrom posB pos).1 }
+      else
+        let m := (b + e) / 2;
+        let posM := ps.get! m;
+        if pos == posM then { line := fmap.getLine m, column := 0 }
+        else if pos > posM then loop m e
+        else loop b m
+    loop 0 (ps.size -1)
+  else if ps.isEmpty then
+    ⟨0, 0⟩
+  else
+    -- Some systems like the delaborator use synthetic positions without an input file,
+    -- which would violate `toPositionAux`'s invariant.
+    -- Can also happen with EOF errors, which are not strictly inside the file.
+    ⟨fmap.getLastLine, (pos - ps.back).byteIdx⟩
 
 /-- Convert a `Lean.Position` to a `String.Pos`. -/
 def ofPosition (text : FileMap) (pos : Position) : String.Pos :=
@@ -102,7 +244,7 @@ def ofPosition (text : FileMap) (pos : Position) : String.Pos :=
       0
     else
       text.positions.back
-  String.Iterator.nextn ⟨text.source, colPos⟩ pos.column |>.pos
+  text.codepoints.advance colPos pos.column
 
 /--
 Returns the position of the start of (1-based) line `line`.
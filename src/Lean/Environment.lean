@@ -80,6 +80,26 @@ structure ModuleData where
   entries         : Array (Name × Array EnvExtensionEntry)
   deriving Inhabited
 
+opaque ImportedConstIndexPointed : NonemptyType.{0}
+/--
+Immutable index for the constants imported from a collection of modules.
+The kernel (`environment::find`) uses it to look up imported constants without going through `ConstMap`.
+-/
+def ImportedConstIndex : Type := ImportedConstIndexPointed.type
+instance : Nonempty ImportedConstIndex := ImportedConstIndexPointed.property
+
+/-- Create the index for the constants in `moduleData`. -/
+@[extern "lean_mk_imported_const_index"]
+opaque mkImportedConstIndex (moduleData : @& Array ModuleData) : ImportedConstIndex
+
+/-- Return the imported constant `declName` if it is in the index. -/
+@[extern "lean_imported_const_index_find"]
+opaque ImportedConstIndex.find? (idx : @& ImportedConstIndex) (declName : @& Name) : Option ConstantInfo
+
+/-- Address of the C++ object implementing `idx`. It is valid as long as `idx` is alive. -/
+@[extern "lean_imported_const_index_ptr"]
+opaque ImportedConstIndex.ptr (idx : @& ImportedConstIndex) : USize
+
 /-- Environment fields that are not used often. -/
 structure EnvironmentHeader where
   /--
@@ -104,6 +124,8 @@ structure EnvironmentHeader where
   moduleNames  : Array Name   := #[]
   /-- Module data for all imported modules. -/
   moduleData   : Array ModuleData := #[]
+  /-- Index for the constants in `moduleData`. -/
+  constIndex   : ImportedConstIndex := mkImportedConstIndex #[]
   deriving Nonempty
 
 /--
@@ -204,6 +226,14 @@ private def isQuotInit (env : Environment) : Bool :=
 private def getTrustLevel (env : Environment) : UInt32 :=
   env.header.trustLevel
 
+/-
+  The kernel uses the index on every `environment::find`. Thus, `env` is borrowed and we return
+  the address of the index, which avoids (potentially atomic) reference counter updates.
+-/
+@[export lean_environment_imported_const_index]
+private def getImportedConstIndex (env : @& Environment) : USize :=
+  env.header.constIndex.ptr
+
 def getModuleIdxFor? (env : Environment) (declName : Name) : Option ModuleIdx :=
   env.const2ModIdx[declName]?
 
@@ -843,6 +873,37 @@ private def equivInfo (cinfo₁ cinfo₂ : ConstantInfo) : Bool := Id.run do
     && tval₁.levelParams == tval₂.levelParams
     && tval₁.all == tval₂.all
 
+/-- Mapping from constant name to the first module (in import order) declaring it. -/
+private def mkConst2ModIdx (moduleData : Array ModuleData) (numConsts : Nat) : Std.HashMap Name ModuleIdx := Id.run do
+  let mut const2ModIdx : Std.HashMap Name ModuleIdx := Std.HashMap.empty (capacity := numConsts)
+  for h:modIdx in [0:moduleData.size] do
+    let mod := moduleData[modIdx]'h.upper
+    for cname in mod.constNames do
+      const2ModIdx := const2ModIdx.insertIfNew cname modIdx
+    for cname in mod.extraConstNames do
+      const2ModIdx := const2ModIdx.insertIfNew cname modIdx
+  return const2ModIdx
+
+/--
+Mapping from constant name to `ConstantInfo` for the imported constants.
+It also returns the first module and constant name (in import order) such that
+the constant has already been imported with a different `ConstantInfo`.
+-/
+private def mkImportedConstantMap (moduleData : Array ModuleData) (numConsts : Nat) :
+    Std.HashMap Name ConstantInfo × Option (Nat × Name) := Id.run do
+  let mut constantMap : Std.HashMap Name ConstantInfo := Std.HashMap.empty (capacity := numConsts)
+  for h:modIdx in [0:moduleData.size] do
+    let mod := moduleData[modIdx]'h.upper
+    for cname in mod.constNames, cinfo in mod.constants do
+      match constantMap.getThenInsertIfNew? cname cinfo with
+      | (cinfoPrev?, constantMap') =>
+        constantMap := constantMap'
+        if let some cinfoPrev := cinfoPrev? then
+          -- Recall that the map has not been modified when `cinfoPrev? = some _`.
+          unless equivInfo cinfoPrev cinfo do
+            return (constantMap, some (modIdx, cname))
+  return (constantMap, none)
+
 /--
   Construct environment from `importModulesCore` results.
 
@@ -856,21 +917,15 @@ def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (
     (leakEnv := false) : IO Environment := do
   let numConsts := s.moduleData.foldl (init := 0) fun numConsts mod =>
     numConsts + mod.constants.size + mod.extraConstNames.size
-  let mut const2ModIdx : Std.HashMap Name ModuleIdx := Std.HashMap.empty (capacity := numConsts)
-  let mut constantMap : Std.HashMap Name ConstantInfo := Std.HashMap.empty (capacity := numConsts)
-  for h:modIdx in [0:s.moduleData.size] do
-    let mod := s.moduleData[modIdx]'h.upper
-    for cname in mod.constNames, cinfo in mod.constants do
-      match constantMap.getThenInsertIfNew? cname cinfo with
-      | (cinfoPrev?, constantMap') =>
-        constantMap := constantMap'
-        if let some cinfoPrev := cinfoPrev? then
-          -- Recall that the map has not been modified when `cinfoPrev? = some _`.
-          unless equivInfo cinfoPrev cinfo do
-            throwAlreadyImported s const2ModIdx modIdx cname
-      const2ModIdx := const2ModIdx.insertIfNew cname modIdx
-    for cname in mod.extraConstNames do
-      const2ModIdx := const2ModIdx.insertIfNew cname modIdx
+  -- The following maps are independent, and are built in parallel.
+  let const2ModIdxTask := Task.spawn fun _ => mkConst2ModIdx s.moduleData numConsts
+  let constIndexTask := Task.spawn fun _ => mkImportedConstIndex s.moduleData
+  let (constantMap, alreadyImported?) := mkImportedConstantMap s.moduleData numConsts
+  let const2ModIdx := const2ModIdxTask.get
+  if let some (modIdx, cname) := alreadyImported? then
+    /- `throwAlreadyImported` only uses `const2ModIdx[cname]`, the first module declaring `cname`.
+       So, the error is the same one produced when the maps are built in a single traversal. -/
+    throwAlreadyImported s const2ModIdx modIdx cname
   let constants : ConstMap := SMap.fromHashMap constantMap false
   let exts ← mkInitialExtensionStates
   let mut env : Environment := {
@@ -885,6 +940,7 @@ def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (
       regions      := s.regions
       moduleNames  := s.moduleNames
       moduleData   := s.moduleData
+      constIndex   := constIndexTask.get
     }
   }
   env ← setImportedEntries env s.moduleData
@@ -18,7 +18,7 @@ structure Context where
 structure State where
   canon      : Canonicalizer.State := {}
   /-- `ShareCommon` (aka `Hashconsing`) state. -/
-  scState    : ShareCommon.State.{0} ShareCommon.objectFactory := ShareCommon.State.mk _
+  scState    : ShareCommon.NativeState := default
   /-- Next index for creating auxiliary theorems. -/
   nextThmIdx : Nat := 1
 
@@ -35,7 +35,7 @@ def abstractNestedProofs (e : Expr) : GrindM Expr := do
 
 def shareCommon (e : Expr) : GrindM Expr := do
   modifyGet fun { canon, scState, nextThmIdx } =>
-    let (e, scState) := ShareCommon.State.shareCommon scState e
+    let (e, scState) := scState.shareCommon e
     (e, { canon, scState, nextThmIdx })
 
 def canon (e : Expr) : GrindM Expr := do
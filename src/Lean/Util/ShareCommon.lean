@@ -29,6 +29,9 @@ def persistentObjectFactory :=
 abbrev ShareCommonT := _root_.ShareCommonT objectFactory
 abbrev PShareCommonT := _root_.ShareCommonT persistentObjectFactory
 abbrev ShareCommonM := ShareCommonT Id
+/-- Variant of `ShareCommonT` using native hash tables, see `ShareCommon.NativeState`. -/
+abbrev NShareCommonT := StateT NativeState
+abbrev NShareCommonM := NShareCommonT Id
 abbrev PShareCommonM := PShareCommonT Id
 
 @[specialize] def ShareCommonT.withShareCommon [Monad m] (a : α) : ShareCommonT m α :=
@@ -37,15 +40,23 @@ abbrev PShareCommonM := PShareCommonT Id
 @[specialize] def PShareCommonT.withShareCommon [Monad m] (a : α) : PShareCommonT m α :=
   modifyGet fun s => s.shareCommon a
 
+@[specialize] def NShareCommonT.withShareCommon [Monad m] (a : α) : NShareCommonT m α :=
+  modifyGet fun s => s.shareCommon a
+
 instance ShareCommonT.monadShareCommon [Monad m] : MonadShareCommon (ShareCommonT m) where
   withShareCommon := ShareCommonT.withShareCommon
 
 instance PShareCommonT.monadShareCommon [Monad m] : MonadShareCommon (PShareCommonT m) where
   withShareCommon := PShareCommonT.withShareCommon
 
+instance NShareCommonT.monadShareCommon [Monad m] : MonadShareCommon (NShareCommonT m) where
+  withShareCommon := NShareCommonT.withShareCommon
+
 @[inline] def ShareCommonT.run [Monad m] : ShareCommonT m α → m α := _root_.ShareCommonT.run
 @[inline] def PShareCommonT.run [Monad m] : PShareCommonT m α → m α := _root_.ShareCommonT.run
 @[inline] def ShareCommonM.run : ShareCommonM α → α := ShareCommonT.run
 @[inline] def PShareCommonM.run : PShareCommonM α → α := PShareCommonT.run
+@[inline] def NShareCommonT.run [Monad m] (x : NShareCommonT m α) : m α := x.run' default
+@[inline] def NShareCommonM.run : NShareCommonM α → α := NShareCommonT.run
 
 def shareCommon (a : α) : α := (withShareCommon a : ShareCommonM α).run
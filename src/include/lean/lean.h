@@ -416,32 +416,76 @@ static inline _Atomic(int) * lean_get_rc_mt_addr(lean_object* o) {
     return (_Atomic(int)*)(&(o->m_rc));
 }
 
+#ifdef LEAN_OLEAN_RANGE_CHECK
+/* Address range reserved for memory-mapped .olean files, empty if the reservation failed.
+   All objects in this range are persistent. We check the address before touching the object header, which
+   is usually in a cold page of the mapped file. See `reserve_olean_region`. */
+LEAN_EXPORT extern size_t lean_olean_region_begin;
+LEAN_EXPORT extern size_t lean_olean_region_size;
+
+static inline bool lean_in_olean_region(lean_object * o) {
+    return (size_t)o - lean_olean_region_begin < lean_olean_region_size;
+}
+#endif
+
+#ifdef LEAN_RUNTIME_STATS
+/* Count reference counter operations on persistent objects. */
+LEAN_EXPORT void lean_stat_persistent_rc_op(bool is_dec);
+#define LEAN_PERSISTENT_RC_STAT(is_dec) lean_stat_persistent_rc_op(is_dec)
+#else
+#define LEAN_PERSISTENT_RC_STAT(is_dec)
+#endif
+
 LEAN_EXPORT void lean_inc_ref_cold(lean_object * o);
 LEAN_EXPORT void lean_inc_ref_n_cold(lean_object * o, unsigned n);
 
 static inline void lean_inc_ref(lean_object * o) {
+#ifdef LEAN_OLEAN_RANGE_CHECK
+    if (lean_in_olean_region(o)) {
+        LEAN_PERSISTENT_RC_STAT(false);
+        return;
+    }
+#endif
     if (LEAN_LIKELY(lean_is_st(o))) {
         o->m_rc++;
     } else if (o->m_rc != 0) {
         lean_inc_ref_cold(o);
+    } else {
+        LEAN_PERSISTENT_RC_STAT(false);
     }
 }
 
 static inline void lean_inc_ref_n(lean_object * o, size_t n) {
+#ifdef LEAN_OLEAN_RANGE_CHECK
+    if (lean_in_olean_region(o)) {
+        LEAN_PERSISTENT_RC_STAT(false);
+        return;
+    }
+#endif
     if (LEAN_LIKELY(lean_is_st(o))) {
         o->m_rc += n;
     } else if (o->m_rc != 0) {
         lean_inc_ref_n_cold(o, n);
+    } else {
+        LEAN_PERSISTENT_RC_STAT(false);
     }
 }
 
 LEAN_EXPORT void lean_dec_ref_cold(lean_object * o);
 
 static inline void lean_dec_ref(lean_object * o) {
+#ifdef LEAN_OLEAN_RANGE_CHECK
+    if (lean_in_olean_region(o)) {
+        LEAN_PERSISTENT_RC_STAT(true);
+        return;
+    }
+#endif
     if (LEAN_LIKELY(o->m_rc > 1)) {
         o->m_rc--;
     } else if (o->m_rc != 0) {
         lean_dec_ref_cold(o);
+    } else {
+        LEAN_PERSISTENT_RC_STAT(true);
     }
 }
 static inline void lean_inc(lean_object * o) { if (!lean_is_scalar(o)) lean_inc_ref(o); }
@@ -566,6 +610,27 @@ static inline void lean_ctor_release(b_lean_obj_arg o, unsigned i) {
     objs[i] = lean_box(0);
 }
 
+/* Constructor objects in the stack frame of the function creating them.
+   The C code generator uses them for constructor applications that do not escape the function (see `Decl.stackCtors`).
+   They have a non-heap header (`m_rc == 0`), so `lean_inc` and `lean_dec` are no-ops on them. Instead, the single
+   reference to such an object is consumed using `lean_dec_stack_ctor`. */
+#define LEAN_STACK_CTOR(name, num_objs, scalar_sz) \
+    uint64_t name[(sizeof(lean_ctor_object) + sizeof(void*)*(num_objs) + (scalar_sz) + sizeof(uint64_t) - 1) / sizeof(uint64_t)]
+
+static inline lean_object * lean_init_stack_ctor(void * mem, unsigned tag, unsigned num_objs, unsigned scalar_sz) {
+    assert(tag <= LeanMaxCtorTag && num_objs < LEAN_MAX_CTOR_FIELDS && scalar_sz < LEAN_MAX_CTOR_SCALARS_SIZE);
+    lean_object * o = (lean_object*)mem;
+    lean_set_non_heap_header(o, sizeof(lean_ctor_object) + sizeof(void*)*num_objs + scalar_sz, tag, num_objs);
+    return o;
+}
+
+static inline void lean_dec_stack_ctor(lean_object * o) {
+    lean_object ** objs = lean_ctor_obj_cptr(o);
+    unsigned n = lean_ctor_num_objs(o);
+    for (unsigned i = 0; i < n; i++)
+        lean_dec(objs[i]);
+}
+
 static inline size_t lean_ctor_get_usize(b_lean_obj_arg o, unsigned i) {
     assert(i >= lean_ctor_num_objs(o));
     return *((size_t*)(lean_ctor_obj_cptr(o) + i));
@@ -671,6 +736,24 @@ LEAN_EXPORT lean_object* lean_apply_n(lean_object* f, unsigned n, lean_object**
 /* Pre: n > 16 */
 LEAN_EXPORT lean_object* lean_apply_m(lean_object* f, unsigned n, lean_object** args);
 
+/* Same as `lean_apply_<n>`, but `f` is borrowed. */
+LEAN_EXPORT lean_object* lean_apply_1_b(lean_object* f, lean_object* a1);
+LEAN_EXPORT lean_object* lean_apply_2_b(lean_object* f, lean_object* a1, lean_object* a2);
+LEAN_EXPORT lean_object* lean_apply_3_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3);
+LEAN_EXPORT lean_object* lean_apply_4_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4);
+LEAN_EXPORT lean_object* lean_apply_5_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5);
+LEAN_EXPORT lean_object* lean_apply_6_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6);
+LEAN_EXPORT lean_object* lean_apply_7_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7);
+LEAN_EXPORT lean_object* lean_apply_8_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8);
+LEAN_EXPORT lean_object* lean_apply_9_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9);
+LEAN_EXPORT lean_object* lean_apply_10_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10);
+LEAN_EXPORT lean_object* lean_apply_11_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11);
+LEAN_EXPORT lean_object* lean_apply_12_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12);
+LEAN_EXPORT lean_object* lean_apply_13_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13);
+LEAN_EXPORT lean_object* lean_apply_14_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14);
+LEAN_EXPORT lean_object* lean_apply_15_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15);
+LEAN_EXPORT lean_object* lean_apply_16_b(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16);
+
 /* Arrays of objects (low level API) */
 static inline lean_obj_res lean_alloc_array(size_t size, size_t capacity) {
     lean_array_object * o = (lean_array_object*)lean_alloc_object(sizeof(lean_array_object) + sizeof(void*)*capacity);
@@ -1156,6 +1239,9 @@ LEAN_EXPORT lean_object * lean_nat_big_succ(lean_object * a);
 LEAN_EXPORT lean_object * lean_nat_big_add(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_nat_big_sub(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_nat_big_mul(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_nat_big_add_in_place(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_nat_big_sub_in_place(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_nat_big_mul_in_place(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_nat_overflow_mul(size_t a1, size_t a2);
 LEAN_EXPORT lean_object * lean_nat_big_div(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_nat_big_mod(lean_object * a1, lean_object * a2);
@@ -1228,6 +1314,28 @@ static inline lean_obj_res lean_nat_mul(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     }
 }
 
+/* Variants of `lean_nat_add/sub/mul` that consume `a1`, and reuse its memory if it is an exclusive big number. */
+static inline lean_obj_res lean_nat_add_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_nat_add(a1, a2);
+    else
+        return lean_nat_big_add_in_place(a1, a2);
+}
+
+static inline lean_obj_res lean_nat_sub_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_nat_sub(a1, a2);
+    else
+        return lean_nat_big_sub_in_place(a1, a2);
+}
+
+static inline lean_obj_res lean_nat_mul_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_nat_mul(a1, a2);
+    else
+        return lean_nat_big_mul_in_place(a1, a2);
+}
+
 static inline lean_obj_res lean_nat_div(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2))) {
         size_t n1 = lean_unbox(a1);
@@ -1332,6 +1440,9 @@ LEAN_EXPORT lean_object * lean_int_big_neg(lean_object * a);
 LEAN_EXPORT lean_object * lean_int_big_add(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_int_big_sub(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_int_big_mul(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_int_big_add_in_place(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_int_big_sub_in_place(lean_object * a1, lean_object * a2);
+LEAN_EXPORT lean_object * lean_int_big_mul_in_place(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_int_big_div(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_int_big_mod(lean_object * a1, lean_object * a2);
 LEAN_EXPORT lean_object * lean_int_big_ediv(lean_object * a1, lean_object * a2);
@@ -1429,6 +1540,28 @@ static inline lean_obj_res lean_int_mul(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     }
 }
 
+/* Variants of `lean_int_add/sub/mul` that consume `a1`, and reuse its memory if it is an exclusive big number. */
+static inline lean_obj_res lean_int_add_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_int_add(a1, a2);
+    else
+        return lean_int_big_add_in_place(a1, a2);
+}
+
+static inline lean_obj_res lean_int_sub_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_int_sub(a1, a2);
+    else
+        return lean_int_big_sub_in_place(a1, a2);
+}
+
+static inline lean_obj_res lean_int_mul_in_place(lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2)))
+        return lean_int_mul(a1, a2);
+    else
+        return lean_int_big_mul_in_place(a1, a2);
+}
+
 static inline lean_obj_res lean_int_div(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2))) {
         if (sizeof(void*) == 8) {
@@ -1976,6 +2109,14 @@ static inline size_t lean_ptr_addr(b_lean_obj_arg a) { return (size_t)a; }
 
 /* Name primitives */
 LEAN_EXPORT uint8_t lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2);
+/* Return the interned name equal to `n` if there is one, and `n` otherwise. `n` itself is never added to the table of
+   interned names. It is the identity function if the runtime was not built with `LEAN_INTERN_NAMES`. */
+LEAN_EXPORT lean_obj_res lean_name_intern(lean_obj_arg n);
+/* Add `n`, which must be stored in a compacted region, to the table of interned names. */
+LEAN_EXPORT void lean_name_register(b_lean_obj_arg n);
+/* Remove every interned name whose prefixes point into the memory `[begin, begin+size)`. It must be used before
+   freeing a compacted region. */
+LEAN_EXPORT void lean_name_forget_region(void const * begin, size_t size);
 
 static inline uint64_t lean_name_hash_ptr(b_lean_obj_arg n) {
     assert(!lean_is_scalar(n));
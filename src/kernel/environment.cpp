@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include <limits>
+#include <algorithm>
 #include "runtime/sstream.h"
 #include "runtime/thread.h"
 #include "runtime/sharecommon.h"
@@ -29,6 +30,7 @@ extern "C" object* lean_get_extension(object*, object*);
 extern "C" object* lean_set_extension(object*, object*, object*);
 extern "C" object* lean_environment_set_main_module(object*, object*);
 extern "C" object* lean_environment_main_module(object*);
+extern "C" size_t lean_environment_imported_const_index(b_obj_arg);
 extern "C" object* lean_kernel_record_unfold (object*, object*);
 extern "C" object* lean_kernel_get_diag(object*);
 extern "C" object* lean_kernel_set_diag(object*, object*);
@@ -98,11 +100,210 @@ void environment::mark_quot_initialized() {
     m_obj = lean_environment_mark_quot_init(m_obj);
 }
 
+/*
+  Immutable index for the constants imported by an environment (see `mkImportedConstIndex`).
+  It is a perfect hash table built using the "hash and displace" approach:
+  the name hash codes are distributed into buckets, and for each bucket (largest first) we search
+  for a seed that maps all its names to free slots. A lookup computes a single slot, and compares
+  the hash code and the name stored there. We use a load factor of 0.8 since the search for the
+  last seeds of a minimal perfect hash table is too expensive.
+  Different names with the same hash code cannot be placed by any seed, so all but the first one
+  are stored in `m_collisions`, which is only searched when the slot does not contain the name.
+*/
+class imported_const_index {
+    object *              m_module_data; // keeps the names and constants alive
+    std::vector<uint32>   m_seeds;       // one per bucket
+    std::vector<uint64>   m_hashes;      // slot -> name hash
+    std::vector<object *> m_names;       // slot -> name
+    std::vector<object *> m_infos;       // slot -> `ConstantInfo`
+    std::vector<std::pair<object *, object *>> m_collisions; // (name, `ConstantInfo`) pairs not in the slots
+
+    static constexpr unsigned bucket_size = 4;
+    static constexpr uint32 max_seed      = 1u << 16;
+
+    static size_t slot_of(uint64 h, uint32 seed, size_t n) {
+        uint64 x = h + seed * 0x9e3779b97f4a7c15ull;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return x % n;
+    }
+
+    size_t bucket_of(uint64 h) const { return h % m_seeds.size(); }
+
+    bool build(std::vector<uint64> const & hashes, std::vector<object *> const & names, std::vector<object *> const & infos) {
+        size_t n = names.size();
+        size_t m = n + n / 4 + 1;
+        std::vector<std::vector<unsigned>> buckets(n / bucket_size + 1);
+        m_seeds.resize(buckets.size(), 0);
+        for (unsigned i = 0; i < n; i++)
+            buckets[bucket_of(hashes[i])].push_back(i);
+        std::vector<unsigned> order(buckets.size());
+        for (unsigned b = 0; b < order.size(); b++) order[b] = b;
+        std::sort(order.begin(), order.end(), [&](unsigned b1, unsigned b2) { return buckets[b1].size() > buckets[b2].size(); });
+        m_hashes.resize(m, 0);
+        m_names.resize(m, nullptr);
+        m_infos.resize(m, nullptr);
+        std::vector<size_t> slots;
+        for (unsigned b : order) {
+            std::vector<unsigned> const & bucket = buckets[b];
+            if (bucket.empty())
+                break;
+            uint32 seed = 0;
+            while (true) {
+                if (seed == max_seed)
+                    return false;
+                slots.clear();
+                bool ok = true;
+                for (unsigned i : bucket) {
+                    size_t s = slot_of(hashes[i], seed, m);
+                    if (m_names[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) {
+                        ok = false;
+                        break;
+                    }
+                    slots.push_back(s);
+                }
+                if (ok)
+                    break;
+                seed++;
+            }
+            m_seeds[b] = seed;
+            for (unsigned j = 0; j < bucket.size(); j++) {
+                unsigned i = bucket[j];
+                m_hashes[slots[j]] = hashes[i];
+                m_names[slots[j]]  = names[i];
+                m_infos[slots[j]]  = infos[i];
+            }
+        }
+        return true;
+    }
+
+public:
+    imported_const_index(object * module_data):m_module_data(module_data) {
+        inc(m_module_data);
+        std::vector<uint64>   hashes;
+        std::vector<object *> names;
+        std::vector<object *> infos;
+        for (size_t i = 0; i < array_size(module_data); i++) {
+            object * mod = lean_array_get_core(module_data, i);
+            // `ModuleData.constNames` and `ModuleData.constants`
+            object * mod_names = cnstr_get(mod, 1);
+            object * mod_infos = cnstr_get(mod, 2);
+            for (size_t j = 0; j < array_size(mod_names); j++) {
+                hashes.push_back(lean_name_hash(lean_array_get_core(mod_names, j)));
+                names.push_back(lean_array_get_core(mod_names, j));
+                infos.push_back(lean_array_get_core(mod_infos, j));
+            }
+        }
+        /*
+          A constant may be imported from different modules. We keep the first occurrence.
+          After sorting, the entries with the same hash code are adjacent, but equal names are not necessarily
+          neighbours when different names share the hash code. So, we compare each entry with all the entries kept
+          for its hash code.
+        */
+        std::vector<unsigned> idxs(names.size());
+        for (unsigned i = 0; i < idxs.size(); i++) idxs[i] = i;
+        std::stable_sort(idxs.begin(), idxs.end(), [&](unsigned i1, unsigned i2) { return hashes[i1] < hashes[i2]; });
+        std::vector<uint64>   u_hashes;
+        std::vector<object *> u_names;
+        std::vector<object *> u_infos;
+        size_t run_begin = 0; // first entry of `m_collisions` with the current hash code
+        for (unsigned k = 0; k < idxs.size(); k++) {
+            unsigned i = idxs[k];
+            if (!u_hashes.empty() && u_hashes.back() == hashes[i]) {
+                auto same = [&](std::pair<object *, object *> const & p) { return lean_name_eq(p.first, names[i]); };
+                if (lean_name_eq(u_names.back(), names[i]) ||
+                    std::any_of(m_collisions.begin() + run_begin, m_collisions.end(), same))
+                    continue;
+                m_collisions.emplace_back(names[i], infos[i]);
+                continue;
+            }
+            run_begin = m_collisions.size();
+            u_hashes.push_back(hashes[i]);
+            u_names.push_back(names[i]);
+            u_infos.push_back(infos[i]);
+        }
+        if (u_names.empty() || !build(u_hashes, u_names, u_infos)) {
+            // `find` always fails, and `environment::find` falls back to the `ConstMap`
+            m_seeds.clear(); m_hashes.clear(); m_names.clear(); m_infos.clear(); m_collisions.clear();
+        }
+    }
+
+    ~imported_const_index() { dec(m_module_data); }
+
+    object * get_module_data() const { return m_module_data; }
+
+    /* Return the `ConstantInfo` for `n` if it is an imported constant. The result is a borrowed reference. */
+    object * find(b_obj_arg n) const {
+        if (m_names.empty())
+            return nullptr;
+        uint64 h = lean_name_hash(n);
+        size_t s = slot_of(h, m_seeds[bucket_of(h)], m_names.size());
+        if (m_hashes[s] == h && lean_name_eq(m_names[s], n))
+            return m_infos[s];
+        for (auto const & p : m_collisions) {
+            if (lean_name_eq(p.first, n))
+                return p.second;
+        }
+        return nullptr;
+    }
+};
+
+static void imported_const_index_finalizer(void * p) {
+    delete static_cast<imported_const_index *>(p);
+}
+
+static void imported_const_index_foreach(void * p, b_obj_arg fn) {
+    object * o = static_cast<imported_const_index *>(p)->get_module_data();
+    lean_inc(fn); lean_inc(o);
+    lean_dec(lean_apply_1(fn, o));
+}
+
+/*
+  The class is registered on demand because the initializer of the module `Lean.Environment`,
+  which creates the default `EnvironmentHeader`, is executed before `initialize_environment`.
+*/
+static lean_external_class * get_imported_const_index_class() {
+    static lean_external_class * c = lean_register_external_class(imported_const_index_finalizer, imported_const_index_foreach);
+    return c;
+}
+
+// opaque mkImportedConstIndex (moduleData : @& Array ModuleData) : ImportedConstIndex
+extern "C" LEAN_EXPORT object * lean_mk_imported_const_index(b_obj_arg module_data) {
+    return lean_alloc_external(get_imported_const_index_class(), new imported_const_index(module_data));
+}
+
+// opaque ImportedConstIndex.find? (idx : @& ImportedConstIndex) (declName : @& Name) : Option ConstantInfo
+extern "C" LEAN_EXPORT object * lean_imported_const_index_find(b_obj_arg index, b_obj_arg n) {
+    if (object * info = static_cast<imported_const_index *>(lean_get_external_data(index))->find(n)) {
+        inc(info);
+        return mk_option_some(info);
+    }
+    return mk_option_none();
+}
+
+// opaque ImportedConstIndex.ptr (idx : @& ImportedConstIndex) : USize
+extern "C" LEAN_EXPORT size_t lean_imported_const_index_ptr(b_obj_arg index) {
+    return reinterpret_cast<size_t>(lean_get_external_data(index));
+}
+
+/*
+  Return the `ConstantInfo` for `n` if it is an imported constant of `env`, and `nullptr` otherwise.
+  The result is a borrowed reference, `env` keeps it alive.
+*/
+static object * find_imported(environment const & env, name const & n) {
+    return reinterpret_cast<imported_const_index *>(lean_environment_imported_const_index(env.raw()))->find(n.raw());
+}
+
 optional<constant_info> environment::find(name const & n) const {
+    if (object * info = find_imported(*this, n))
+        return optional<constant_info>(constant_info(info, true));
     return to_optional<constant_info>(lean_environment_find(to_obj_arg(), n.to_obj_arg()));
 }
 
 constant_info environment::get(name const & n) const {
+    if (object * info = find_imported(*this, n))
+        return constant_info(info, true);
     object * o = lean_environment_find(to_obj_arg(), n.to_obj_arg());
     if (is_scalar(o))
         throw unknown_constant_exception(*this, n);
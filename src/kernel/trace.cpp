@@ -8,13 +8,14 @@ Author: Leonardo de Moura
 #include <string>
 #include "util/io.h"
 #include "util/option_declarations.h"
+#include "util/name_phash_map.h"
 #include "kernel/environment.h"
 #include "kernel/local_ctx.h"
 #include "kernel/trace.h"
 
 namespace lean {
 static name_set *            g_trace_classes = nullptr;
-static name_map<name_set>  * g_trace_aliases = nullptr;
+static name_phash_map<name_set> * g_trace_aliases = nullptr;
 MK_THREAD_LOCAL_GET_DEF(std::vector<name>, get_enabled_trace_classes);
 MK_THREAD_LOCAL_GET_DEF(std::vector<name>, get_disabled_trace_classes);
 LEAN_THREAD_PTR(environment,           g_env);
@@ -89,6 +90,13 @@ bool is_trace_class_enabled(name const & n) {
     return is_trace_class_set(get_enabled_trace_classes(), n);
 }
 
+bool is_other_trace_class_enabled(name const & n) {
+    for (name const & c : get_enabled_trace_classes()) {
+        if (!is_prefix_of(n, c))
+            return true;
+    }
+    return false;
+}
 
 void scope_trace_env::init(environment * env, options * opts) {
     m_enable_sz  = get_enabled_trace_classes().size();
@@ -141,7 +149,7 @@ std::ostream & operator<<(std::ostream & ios, tclass const & c) {
 
 void initialize_trace() {
     g_trace_classes = new name_set();
-    g_trace_aliases = new name_map<name_set>();
+    g_trace_aliases = new name_phash_map<name_set>();
 
     register_trace_class(name{"debug"});
 }
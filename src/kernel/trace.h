@@ -16,6 +16,8 @@ void register_trace_class(name const & n, name const & decl_name = {});
 void register_trace_class_alias(name const & n, name const & alias);
 bool is_trace_enabled();
 bool is_trace_class_enabled(name const & n);
+/** \brief Return true if a trace class that is not `n` or one of its subclasses is enabled. */
+bool is_other_trace_class_enabled(name const & n);
 
 #define lean_is_trace_enabled(CName) (::lean::is_trace_enabled() && ::lean::is_trace_class_enabled(CName))
 
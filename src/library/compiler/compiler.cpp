@@ -4,11 +4,14 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <memory>
 #include "util/option_declarations.h"
 #include "util/io.h"
+#include "util/name_phash_map.h"
 #include "kernel/type_checker.h"
 #include "kernel/kernel_exception.h"
 #include "kernel/trace.h"
+#include "kernel/find_fn.h"
 #include "library/max_sharing.h"
 #include "library/time_task.h"
 #include "library/compiler/util.h"
@@ -34,6 +37,7 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_extract_closed = nullptr;
+static name * g_compiler_stats = nullptr;
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
 
@@ -158,6 +162,53 @@ bool is_main_fn_type(expr const & type) {
 
 #define trace_compiler(k, ds) lean_trace(k, trace_comp_decls(ds););
 
+static unsigned get_lcnf_size(environment const & env, comp_decls const & ds) {
+    unsigned r = 0;
+    for (comp_decl const & d : ds)
+        r += get_lcnf_size(env, d.snd());
+    return r;
+}
+
+/* Instrumentation for a single compiler pass updating `ds` (and `env`) in place. `ds` must be in LCNF.
+   When `profiler` is set, the time spent in the pass is reported as `compilation <pass>`,
+   and the LCNF size of `ds` before and after the pass is added to the cumulative profile counts.
+   The sizes are also traced using `trace.compiler.stats`. Nothing is measured otherwise. */
+class compiler_pass_stats {
+    char const *                 m_pass;
+    environment const &          m_env;
+    comp_decls const &           m_ds;
+    bool                         m_profile;
+    bool                         m_trace;
+    unsigned                     m_size_before = 0;
+    std::unique_ptr<time_task>   m_timer;
+public:
+    compiler_pass_stats(char const * pass, options const & opts, environment const & env, comp_decls const & ds):
+        m_pass(pass), m_env(env), m_ds(ds), m_profile(get_profiler(opts)),
+        m_trace(lean_is_trace_enabled(*g_compiler_stats)) {
+        if (!m_profile && !m_trace) return;
+        m_size_before = get_lcnf_size(m_env, m_ds);
+        /* Started last so that computing sizes is not charged to the pass. */
+        if (m_profile)
+            m_timer.reset(new time_task(std::string("compilation ") + m_pass, opts, head(ds).fst(), /* detail */ true));
+    }
+    /* Must be invoked after the pass has updated `ds`. */
+    void finish() {
+        m_timer.reset();
+        if (!m_profile && !m_trace) return;
+        unsigned size_after = get_lcnf_size(m_env, m_ds);
+        if (m_profile) {
+            std::string category = std::string("compilation ") + m_pass + " size";
+            report_profiling_count(category + " before", m_size_before);
+            report_profiling_count(category + " after", size_after);
+        }
+        lean_trace(*g_compiler_stats,
+                   tout() << m_pass << " " << head(m_ds).fst() << ": " << m_size_before << " -> " << size_after << "\n";);
+    }
+};
+
+/* Run the statements `...`, a compiler pass updating `ds`, with `compiler_pass_stats` enabled. */
+#define compiler_pass(pass, opts, env, ds, ...) { compiler_pass_stats _stats(pass, opts, env, ds); __VA_ARGS__; _stats.finish(); }
+
 extern "C" object* lean_csimp_replace_constants(object* env, object* n);
 
 expr csimp_replace_constants(environment const & env, expr const & e) {
@@ -168,10 +219,12 @@ bool is_matcher(environment const & env, comp_decls const & ds) {
     return length(ds) == 1 && is_matcher(env, head(ds).fst());
 }
 
-environment compile(environment const & env, options const & opts, names cs) {
+/* Return `true` if code must be generated for `cs` using `compile_front` and `compile_back`.
+   Otherwise, `env` is updated if needed (e.g., boxed versions of extern constants), and no further processing is needed. */
+static bool should_compile(environment & env, names & cs) {
     /* Do not generate code for irrelevant decls */
     cs = filter(cs, [&](name const & c) { return !is_irrelevant_type(env, env.get(c).get_type());});
-    if (empty(cs)) return env;
+    if (empty(cs)) return false;
 
     for (name const & c : cs) {
         if (is_main_fn(env, c) && !is_main_fn_type(env.get(c).get_type())) {
@@ -182,46 +235,58 @@ environment compile(environment const & env, options const & opts, names cs) {
     if (length(cs) == 1) {
         name c = get_real_name(head(cs));
         if (has_implemented_by_attribute(env, c))
-            return env;
+            return false;
         if (is_extern_or_init_constant(env, c)) {
             /* Generate boxed version for extern/native constant if needed. */
-            return ir::add_extern(env, c);
+            env = ir::add_extern(env, c);
+            return false;
         }
     }
 
     for (name const & c : cs) {
         lean_assert(!is_extern_constant(env, get_real_name(c)));
         constant_info cinfo = env.get(c);
-        if (!cinfo.is_definition() && !cinfo.is_opaque()) return env;
+        if (!cinfo.is_definition() && !cinfo.is_opaque()) return false;
     }
+    return true;
+}
 
-    time_task t("compilation", opts, head(cs));
-    scope_trace_env scope_trace(env, opts);
-
+/* First part of the pipeline: conversion into LCNF and simplification.
+   These passes do not modify the environment. */
+static comp_decls compile_front(environment const & env, options const & opts, names const & cs) {
     comp_decls ds = to_comp_decls(env, cs);
     csimp_cfg cfg(opts);
-    // Use the following line to see compiler intermediate steps
-    // scope_traces_as_string trace_scope;
     auto simp  = [&](environment const & env, expr const & e) { return csimp(env, e, cfg); };
-    auto esimp = [&](environment const & env, expr const & e) { return cesimp(env, e, cfg); };
     trace_compiler(name({"compiler", "input"}), ds);
-    ds = apply(eta_expand, env, ds);
-    trace_compiler(name({"compiler", "eta_expand"}), ds);
-    ds = apply(to_lcnf, env, ds);
-    ds = apply(find_jp, env, ds);
+    {
+        /* The input is not in LCNF yet, so we can only measure time here. */
+        time_task t("compilation lcnf", opts, head(cs), /* detail */ true);
+        ds = apply(eta_expand, env, ds);
+        trace_compiler(name({"compiler", "eta_expand"}), ds);
+        ds = apply(to_lcnf, env, ds);
+        ds = apply(find_jp, env, ds);
+    }
     // trace(ds);
     trace_compiler(name({"compiler", "lcnf"}), ds);
     // trace(ds);
-    ds = apply(cce, env, ds);
+    compiler_pass("cce", opts, env, ds, ds = apply(cce, env, ds));
     trace_compiler(name({"compiler", "cce"}), ds);
-    ds = apply(csimp_replace_constants, env, ds);
-    ds = apply(simp, env, ds);
+    compiler_pass("simp", opts, env, ds,
+                  ds = apply(csimp_replace_constants, env, ds);
+                  ds = apply(simp, env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
     // trace(ds);
+    return ds;
+}
+
+/* Remaining passes, they add auxiliary declarations and the stage1, stage2 and IR caches to the environment. */
+static environment compile_back(environment const & env, options const & opts, comp_decls ds) {
+    csimp_cfg cfg(opts);
+    auto esimp = [&](environment const & env, expr const & e) { return cesimp(env, e, cfg); };
     environment new_env = env;
-    std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
+    compiler_pass("eager_lambda_lifting", opts, new_env, ds, std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg));
     trace_compiler(name({"compiler", "eager_lambda_lifting"}), ds);
-    ds = apply(max_sharing, ds);
+    compiler_pass("max_sharing", opts, new_env, ds, ds = apply(max_sharing, ds));
     trace_compiler(name({"compiler", "stage1"}), ds);
     new_env = cache_stage1(new_env, ds);
     if (is_matcher(new_env, ds)) {
@@ -233,58 +298,205 @@ environment compile(environment const & env, options const & opts, names cs) {
            when it is partially applied. Then, we can mark all `match` auxiliary functions as `[strong_inline]` */
         return new_env;
     }
-    std::tie(new_env, ds) = specialize(new_env, ds, cfg);
+    compiler_pass("specialize", opts, new_env, ds, std::tie(new_env, ds) = specialize(new_env, ds, cfg));
     // The following check is incorrect. It was exposed by issue #1812.
     // We will not fix the check since we will delete the compiler.
     // lean_assert(lcnf_check_let_decls(new_env, ds));
     trace_compiler(name({"compiler", "specialize"}), ds);
-    ds = apply(elim_dead_let, ds);
+    compiler_pass("elim_dead_let", opts, new_env, ds, ds = apply(elim_dead_let, ds));
     trace_compiler(name({"compiler", "elim_dead_let"}), ds);
-    ds = apply(erase_irrelevant, new_env, ds);
+    compiler_pass("erase_irrelevant", opts, new_env, ds, ds = apply(erase_irrelevant, new_env, ds));
     trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
-    ds = apply(struct_cases_on, new_env, ds);
+    compiler_pass("struct_cases_on", opts, new_env, ds, ds = apply(struct_cases_on, new_env, ds));
     trace_compiler(name({"compiler", "struct_cases_on"}), ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("esimp", opts, new_env, ds, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = reduce_arity(new_env, ds);
+    compiler_pass("reduce_arity", opts, new_env, ds, ds = reduce_arity(new_env, ds));
     trace_compiler(name({"compiler", "reduce_arity"}), ds);
-    std::tie(new_env, ds) = lambda_lifting(new_env, ds);
+    compiler_pass("lambda_lifting", opts, new_env, ds, std::tie(new_env, ds) = lambda_lifting(new_env, ds));
     trace_compiler(name({"compiler", "lambda_lifting"}), ds);
     // trace(ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("esimp", opts, new_env, ds, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
     new_env = cache_stage2(new_env, ds);
     trace_compiler(name({"compiler", "stage2"}), ds);
     if (is_extract_closed_enabled(opts)) {
-        std::tie(new_env, ds) = extract_closed(new_env, ds);
-        ds = apply(elim_dead_let, ds);
-        ds = apply(esimp, new_env, ds);
+        compiler_pass("extract_closed", opts, new_env, ds,
+                      std::tie(new_env, ds) = extract_closed(new_env, ds);
+                      ds = apply(elim_dead_let, ds);
+                      ds = apply(esimp, new_env, ds));
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("esimp", opts, new_env, ds, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = apply(simp_app_args, new_env, ds);
-    ds = apply(ecse, new_env, ds);
-    ds = apply(elim_dead_let, ds);
+    compiler_pass("simp_app_args", opts, new_env, ds,
+                  ds = apply(simp_app_args, new_env, ds);
+                  ds = apply(ecse, new_env, ds);
+                  ds = apply(elim_dead_let, ds));
     trace_compiler(name({"compiler", "simp_app_args"}), ds);
     // std::cout << trace_scope.get_string() << "\n";
     /* compile IR. */
     return compile_ir(new_env, opts, ds);
 }
 
+environment compile(environment const & env, options const & opts, names cs) {
+    environment new_env = env;
+    if (!should_compile(new_env, cs)) return new_env;
+
+    time_task t("compilation", opts, head(cs));
+    scope_trace_env scope_trace(env, opts);
+    // Use the following line to see compiler intermediate steps
+    // scope_traces_as_string trace_scope;
+    comp_decls ds = compile_front(env, opts, cs);
+    return compile_back(env, opts, ds);
+}
+
+/* Return `true` if the values of the declarations in `groups` do not reference declarations in other groups. */
+static bool are_independent(environment const & env, buffer<names> const & groups) {
+    name_phash_map<unsigned> group_of;
+    for (unsigned i = 0; i < groups.size(); i++) {
+        for (name const & c : groups[i]) {
+            group_of.insert(c, i);
+            group_of.insert(get_real_name(c), i);
+        }
+    }
+    for (unsigned i = 0; i < groups.size(); i++) {
+        for (name const & c : groups[i]) {
+            bool allow_opaque = true;
+            expr v = env.get(c).get_value(allow_opaque);
+            bool depends = static_cast<bool>(find(v, [&](expr const & e, unsigned) {
+                        if (!is_constant(e)) return false;
+                        unsigned const * j = group_of.find(const_name(e));
+                        return j && *j != i;
+                    }));
+            if (depends) return false;
+        }
+    }
+    return true;
+}
+
+struct compile_front_job {
+    environment const & m_env;
+    options const &     m_opts;
+    names               m_cs;
+    /* The heartbeat limit, the heartbeat and the cancellation token of the thread executing `compile_batch`. */
+    size_t              m_max_heartbeat;
+    size_t              m_heartbeat;
+    object *            m_cancel_tk;
+    /* The heartbeats consumed by the task. */
+    size_t              m_used_heartbeat;
+    std::exception_ptr  m_ex;
+    compile_front_job(environment const & env, options const & opts, names const & cs):
+        m_env(env), m_opts(opts), m_cs(cs), m_max_heartbeat(get_max_heartbeat()), m_heartbeat(get_heartbeat()),
+        m_cancel_tk(get_cancel_tk()), m_used_heartbeat(0) {}
+};
+
+static obj_res compile_front_fn(obj_arg job_ptr, obj_arg) {
+    compile_front_job & job = *reinterpret_cast<compile_front_job *>(lean_unbox_usize(job_ptr));
+    lean_dec(job_ptr);
+    scope_max_heartbeat s1(job.m_max_heartbeat);
+    scope_heartbeat     s2(job.m_heartbeat);
+    scope_cancel_tk     s3(job.m_cancel_tk);
+    try {
+        time_task t("compilation", job.m_opts, head(job.m_cs));
+        object * r = compile_front(job.m_env, job.m_opts, job.m_cs).steal();
+        job.m_used_heartbeat = get_heartbeat() - job.m_heartbeat;
+        return r;
+    } catch (...) {
+        job.m_used_heartbeat = get_heartbeat() - job.m_heartbeat;
+        job.m_ex = std::current_exception();
+        return box(0);
+    }
+}
+
+/* Compile the given groups of mutual declarations, the result is the same as compiling them one by one using `compile`.
+   If the groups do not reference each other, `compile_front` is executed in parallel for all of them on the task manager.
+   The remaining passes, which update the environment, are executed sequentially in the given order.
+   Each task starts from the caller's heartbeat, and the heartbeats it consumes are charged to the caller
+   before the remaining passes of its group, so the heartbeat limit applies to the whole batch as in the sequential case. */
+environment compile_batch(environment const & env, options const & opts, buffer<names> groups) {
+    environment new_env = env;
+    buffer<names> pending;
+    {
+        scope_trace_env scope_trace(env, opts);
+        /* The tasks do not emit traces, so we compile sequentially if the user wants to see them. */
+        if (groups.size() <= 1 || is_other_trace_class_enabled(name({"compiler", "batch"}))) {
+            for (names const & cs : groups)
+                new_env = compile(new_env, opts, cs);
+            return new_env;
+        }
+    }
+    for (names & cs : groups) {
+        if (should_compile(new_env, cs))
+            pending.push_back(cs);
+    }
+    if (pending.size() <= 1 || !are_independent(new_env, pending)) {
+        for (names const & cs : pending)
+            new_env = compile(new_env, opts, cs);
+        return new_env;
+    }
+    {
+        scope_trace_env scope_trace(new_env, opts);
+        lean_trace(name({"compiler", "batch"}), tout() << "compiling " << pending.size() << " groups in parallel\n";);
+    }
+    /* `new_env`, `opts` and the cancellation token are shared with the tasks */
+    mark_mt(new_env.raw());
+    object * opts_obj = opts.to_obj_arg();
+    mark_mt(opts_obj);
+    dec(opts_obj);
+    if (object * cancel_tk = get_cancel_tk())
+        mark_mt(cancel_tk);
+    std::vector<std::unique_ptr<compile_front_job>> jobs;
+    buffer<object *> tasks;
+    for (names const & cs : pending) {
+        mark_mt(cs.raw());
+        jobs.emplace_back(new compile_front_job(new_env, opts, cs));
+        object * c = lean_alloc_closure((void*)compile_front_fn, 2, 1);
+        lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(jobs.back().get())));
+        tasks.push_back(lean_task_spawn_core(c, 0, false));
+    }
+    /* Remark: we must wait for all tasks before throwing any exception since they reference `jobs`.
+       The remaining results are released by `results` if an exception is thrown. */
+    buffer<object_ref> results;
+    for (object * t : tasks)
+        results.push_back(object_ref(lean_task_get_own(t)));
+    for (unsigned i = 0; i < pending.size(); i++) {
+        if (jobs[i]->m_ex)
+            std::rethrow_exception(jobs[i]->m_ex);
+        add_heartbeats(jobs[i]->m_used_heartbeat);
+        time_task t("compilation", opts, head(pending[i]));
+        scope_trace_env scope_trace(new_env, opts);
+        new_env = compile_back(new_env, opts, comp_decls(results[i].steal()));
+    }
+    return new_env;
+}
+
 extern "C" LEAN_EXPORT object * lean_compile_decls(object * env, object * opts, object * decls) {
     return catch_kernel_exceptions<environment>([&]() {
             return compile(environment(env), options(opts, true), names(decls, true));
         });
 }
 
+extern "C" LEAN_EXPORT object * lean_compile_decls_batch(object * env, object * opts, object * groups) {
+    return catch_kernel_exceptions<environment>([&]() {
+            buffer<names> gs;
+            for (object_ref const & g : list_ref<object_ref>(groups, true))
+                gs.push_back(names(g.raw(), true));
+            return compile_batch(environment(env), options(opts, true), gs);
+        });
+}
+
 void initialize_compiler() {
     g_extract_closed = new name{"compiler", "extract_closed"};
     mark_persistent(g_extract_closed->raw());
     register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
+    g_compiler_stats = new name{"compiler", "stats"};
+    mark_persistent(g_compiler_stats->raw());
+    register_trace_class(*g_compiler_stats);
+    register_trace_class({"compiler", "batch"});
     register_trace_class({"compiler", "inline"});
     register_trace_class({"compiler", "eta_expand"});
     register_trace_class({"compiler", "lcnf"});
@@ -325,5 +537,6 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_compiler_stats;
 }
 }
@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #include "kernel/for_each_fn.h"
 #include "kernel/instantiate.h"
 #include "kernel/abstract.h"
+#include "util/name_phash_map.h"
 #include "library/compiler/util.h"
 
 namespace lean {
@@ -16,7 +17,7 @@ class find_jp_fn {
     environment const & m_env;
     local_ctx           m_lctx;
     name_generator      m_ngen;
-    name_map<unsigned>  m_candidates;
+    name_phash_map<unsigned> m_candidates;
 
     /* Remove all candidates occurring in `e`. */
     void remove_candidates_occurring_at(expr const & e) {
@@ -47,6 +47,7 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #include "library/compiler/init_attribute.h"
 #include "util/nat.h"
 #include "util/option_declarations.h"
+#include "util/name_phash_map.h"
 
 #ifndef LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE
 #define LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE true
@@ -107,6 +108,7 @@ fun_id const & expr_pap_fun(expr const & e) { lean_assert(expr_tag(e) == expr_ki
 array_ref<arg> const & expr_pap_args(expr const & e) { lean_assert(expr_tag(e) == expr_kind::PAp); return cnstr_get_ref_t<array_ref<arg>>(e, 1); }
 var_id const & expr_ap_fun(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Ap); return cnstr_get_ref_t<var_id>(e, 0); }
 array_ref<arg> const & expr_ap_args(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Ap); return cnstr_get_ref_t<array_ref<arg>>(e, 1); }
+bool expr_ap_borrow(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Ap); return get_bool_field(e.raw(), 2); }
 type expr_box_type(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Box); return cnstr_get_type(e, 0); }
 var_id const & expr_box_obj(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Box); return cnstr_get_ref_t<var_id>(e, 1); }
 var_id const & expr_unbox_obj(expr const & e) { lean_assert(expr_tag(e) == expr_kind::Unbox); return cnstr_get_ref_t<var_id>(e, 0); }
@@ -194,7 +196,7 @@ static string_ref * g_boxed_mangled_suffix = nullptr;
 static name * g_interpreter_prefer_native = nullptr;
 
 // constants (lacking native declarations) initialized by `lean_run_init`
-static name_map<object *> * g_init_globals;
+static name_phash_map<object *> * g_init_globals;
 
 // reuse the compiler's name mangling to compute native symbol names
 extern "C" object * lean_name_mangle(object * n, object * pre);
@@ -346,7 +348,7 @@ class interpreter {
       value m_val;
     };
     // caches values of nullary functions ("constants")
-    name_map<constant_cache_entry> m_constant_cache;
+    name_phash_map<constant_cache_entry> m_constant_cache;
     struct symbol_cache_entry {
         decl m_decl;
         // symbol address; `nullptr` if function does not have native code
@@ -355,7 +357,7 @@ class interpreter {
         bool m_boxed;
     };
     // caches symbol lookup successes _and_ failures
-    name_map<symbol_cache_entry> m_symbol_cache;
+    name_phash_map<symbol_cache_entry> m_symbol_cache;
 
     /** \brief Get current stack frame */
     inline frame & get_frame() {
@@ -515,7 +517,12 @@ private:
                 for (size_t i = 0; i < expr_ap_args(e).size(); i++) {
                     args[i] = eval_arg(expr_ap_args(e)[i]).m_obj;
                 }
-                object * r = apply_n(var(expr_ap_fun(e)).m_obj, expr_ap_args(e).size(), args);
+                object * f = var(expr_ap_fun(e)).m_obj;
+                if (expr_ap_borrow(e)) {
+                    // the closure is borrowed, but `apply_n` consumes it
+                    inc(f);
+                }
+                object * r = apply_n(f, expr_ap_args(e).size(), args);
                 return r;
             }
             case expr_kind::Box: // box unboxed value
@@ -1114,7 +1121,7 @@ void initialize_ir_interpreter() {
     ir::g_boxed_mangled_suffix = new string_ref("___boxed");
     mark_persistent(ir::g_boxed_mangled_suffix->raw());
     ir::g_interpreter_prefer_native = new name({"interpreter", "prefer_native"});
-    ir::g_init_globals = new name_map<object *>();
+    ir::g_init_globals = new name_phash_map<object *>();
     register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
     DEBUG_CODE({
         register_trace_class({"interpreter"});
@@ -11,6 +11,7 @@ Author: Leonardo de Moura
 #include "kernel/inductive.h"
 #include "kernel/trace.h"
 #include "library/suffixes.h"
+#include "util/name_phash_map.h"
 #include "library/compiler/util.h"
 
 namespace lean {
@@ -18,7 +19,7 @@ class struct_cases_on_fn {
     type_checker::state m_st;
     local_ctx           m_lctx;
     name_set            m_scrutinies; /* Set of variables `x` such that there is `casesOn x ...` in the context */
-    name_map<name>      m_first_proj; /* Map from variable `x` to the first projection `y := x.i` in the context */
+    name_phash_map<name> m_first_proj; /* Map from variable `x` to the first projection `y := x.i` in the context */
     name_set            m_updated;    /* Set of variables `x` such that there is a `S.mk ... x.i ... */
     name                m_fld{"_d"};
     unsigned            m_next_idx{1};
@@ -150,7 +151,7 @@ class struct_cases_on_fn {
     }
 
     expr visit_let(expr e) {
-        flet<name_map<name>> save(m_first_proj, m_first_proj);
+        flet<name_phash_map<name>> save(m_first_proj, m_first_proj);
         buffer<expr> fvars;
         while (is_let(e)) {
             lean_assert(!has_loose_bvars(let_type(e)));
@@ -86,6 +86,10 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
         // On Linux at least, the stack grows down from ~0x7fff... followed by shared libraries, so reserve
         // a bit of space for them (0x7fff...-0x7f00... = 1TB)
         base_addr = base_addr % 0x7f0000000000;
+#ifdef LEAN_OLEAN_RANGE_CHECK
+        // Place all files in the range reserved for .olean files, leaving 4GB of room for the file itself
+        base_addr = LEAN_OLEAN_REGION_BEGIN + base_addr % (LEAN_OLEAN_REGION_SIZE - (1LL<<32));
+#endif
         // `mmap` addresses must be page-aligned. The default (non-huge) page size on x86-64 is 4KB.
         // `MapViewOfFileEx` addresses must be aligned to the "memory allocation granularity", which is 64KB.
         base_addr = base_addr & ~((1LL<<16) - 1);
@@ -179,12 +183,20 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
             return io_result_mk_error((sstream() << "failed to open '" << olean_fn << "': " << strerror(errno)).str());
         }
 #ifdef LEAN_MMAP
+#ifdef LEAN_OLEAN_RANGE_CHECK
+        buffer = static_cast<char *>(map_olean_file(base_addr, size, fd));
+#else
         buffer = static_cast<char *>(mmap(base_addr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+#endif
 #endif
         close(fd);
         free_data = [=]() {
             if (buffer != MAP_FAILED) {
+#ifdef LEAN_OLEAN_RANGE_CHECK
+                unmap_olean_file(buffer, size);
+#else
                 lean_always_assert(munmap(buffer, size) == 0);
+#endif
             }
         };
 #endif
@@ -206,6 +218,14 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
         }
         in.close();
 
+#ifdef LEAN_INTERN_NAMES
+        /* The constant names of the module are interned, and they must be removed from the table before the region is freed. */
+        std::function<void()> free_region_data = free_data;
+        free_data = [=]() {
+            lean_name_forget_region(buffer, size - sizeof(olean_header));
+            free_region_data();
+        };
+#endif
         compacted_region * region =
           new compacted_region(size - sizeof(olean_header), buffer, base_addr + sizeof(olean_header), is_mmap, free_data);
 #if defined(__has_feature)
@@ -215,6 +235,12 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
 #endif
 #endif
         object * mod = region->read();
+#ifdef LEAN_INTERN_NAMES
+        // `ModuleData.constNames`
+        object * const_names = cnstr_get(mod, 1);
+        for (size_t i = 0; i < array_size(const_names); i++)
+            lean_name_register(lean_array_get_core(const_names, i));
+#endif
         object * mod_region = alloc_cnstr(0, 2, 0);
         cnstr_set(mod_region, 0, mod);
         cnstr_set(mod_region, 1, box_size_t(reinterpret_cast<size_t>(region)));
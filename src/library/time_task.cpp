@@ -12,6 +12,7 @@ Author: Sebastian Ullrich
 namespace lean {
 
 static std::map<std::string, second_duration> * g_cum_times;
+static std::map<std::string, uint64> * g_cum_counts;
 static mutex * g_cum_times_mutex;
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
@@ -20,13 +21,25 @@ void report_profiling_time(std::string const & category, second_duration time) {
     (*g_cum_times)[category] += time;
 }
 
+void report_profiling_count(std::string const & category, uint64 n) {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    (*g_cum_counts)[category] += n;
+}
+
 void display_cumulative_profiling_times(std::ostream & out) {
-    if (g_cum_times->empty())
+    if (g_cum_times->empty() && g_cum_counts->empty())
         return;
     sstream ss;
-    ss << "cumulative profiling times:\n";
-    for (auto const & p : *g_cum_times)
-        ss << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    if (!g_cum_times->empty()) {
+        ss << "cumulative profiling times:\n";
+        for (auto const & p : *g_cum_times)
+            ss << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    }
+    if (!g_cum_counts->empty()) {
+        ss << "cumulative profiling counts:\n";
+        for (auto const & p : *g_cum_counts)
+            ss << "\t" << p.first << " " << p.second << "\n";
+    }
     // output atomically, like IO.print
     out << ss.str();
 }
@@ -34,15 +47,17 @@ void display_cumulative_profiling_times(std::ostream & out) {
 void initialize_time_task() {
     g_cum_times_mutex = new mutex;
     g_cum_times = new std::map<std::string, second_duration>;
+    g_cum_counts = new std::map<std::string, uint64>;
 }
 
 void finalize_time_task() {
+    delete g_cum_counts;
     delete g_cum_times;
     delete g_cum_times_mutex;
 }
 
-time_task::time_task(std::string const & category, options const & opts, name decl) :
-        m_category(category) {
+time_task::time_task(std::string const & category, options const & opts, name decl, bool detail) :
+        m_category(category), m_detail(detail) {
     if (get_profiler(opts)) {
         m_timeit = optional<xtimeit>(get_profiling_threshold(opts), [=](second_duration duration) mutable {
             sstream ss;
@@ -53,14 +68,17 @@ time_task::time_task(std::string const & category, options const & opts, name de
             // output atomically, like IO.print
             tout() << ss.str();
         });
-        m_parent_task = g_current_time_task;
-        g_current_time_task = this;
+        if (!m_detail) {
+            m_parent_task = g_current_time_task;
+            g_current_time_task = this;
+        }
     }
 }
 
 time_task::~time_task() {
     if (m_timeit) {
-        g_current_time_task = m_parent_task;
+        if (!m_detail)
+            g_current_time_task = m_parent_task;
         report_profiling_time(m_category, m_timeit->get_elapsed());
         if (m_parent_task && m_parent_task->m_timeit)
             // report exclusive times
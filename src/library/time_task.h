@@ -12,15 +12,21 @@ Author: Sebastian Ullrich
 
 namespace lean {
 LEAN_EXPORT void report_profiling_time(std::string const & category, second_duration time);
+/** Add `n` to the counter `category` of the final cumulative profile. */
+LEAN_EXPORT void report_profiling_count(std::string const & category, uint64 n);
 LEAN_EXPORT void display_cumulative_profiling_times(std::ostream & out);
 
-/** Measure time of some task and report it for the final cumulative profile. */
+/** Measure time of some task and report it for the final cumulative profile.
+    The time of a nested task is excluded from the time reported for the enclosing one, unless
+    `detail` is true: then the task only breaks down the time of the enclosing task (e.g., the passes of
+    `compilation`), and is not excluded from it. */
 class LEAN_EXPORT time_task {
     std::string     m_category;
     optional<xtimeit> m_timeit;
-    time_task *     m_parent_task;
+    time_task *     m_parent_task = nullptr;
+    bool            m_detail;
 public:
-    time_task(std::string const & category, options const & opts, name decl = name());
+    time_task(std::string const & category, options const & opts, name decl = name(), bool detail = false);
     ~time_task();
 };
 
@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+*/
+#include "runtime/apply.h"
+
+/*
+  Closure application with a borrowed closure.
+
+  `lean_apply_<n>_b(f, a_1, ..., a_n)` is equivalent to `lean_inc(f); lean_apply_<n>(f, a_1, ..., a_n)`,
+  but in the common saturated case, it does not touch the reference counter of `f`, and it does
+  not have to check whether `f` is exclusive. The compiler uses these functions when the closure is
+  still alive after the application (e.g., a closure applied in a loop). See `Lean.IR.ExplicitRC`.
+  Remark: the fixed arguments are still incremented since the closure function takes ownership
+  of all its arguments. */
+
+namespace lean {
+#define obj lean_object
+#define fx(i) lean_closure_arg_cptr(f)[i]
+
+static obj * apply_borrowed(obj * f, unsigned n, obj ** as) {
+    if (lean_is_scalar(f)) { // f is an erased proof
+        for (unsigned i = 0; i < n; i++) lean_dec(as[i]);
+        return f;
+    }
+    unsigned arity = lean_closure_arity(f);
+    unsigned fixed = lean_closure_num_fixed(f);
+    if (LEAN_LIKELY(arity == fixed + n)) {
+        if (fixed == 0)
+            return curry(lean_closure_fun(f), arity, as);
+        obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+        for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+        for (unsigned i = 0; i < n; i++) args[fixed+i] = as[i];
+        return curry(lean_closure_fun(f), arity, args);
+    } else {
+        // partial application or over-application
+        lean_inc_ref(f);
+        return lean_apply_n(f, n, as);
+    }
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_1_b(obj* f, obj* a1) {
+    obj * as[1] = { a1 };
+    return apply_borrowed(f, 1, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_2_b(obj* f, obj* a1, obj* a2) {
+    obj * as[2] = { a1, a2 };
+    return apply_borrowed(f, 2, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_3_b(obj* f, obj* a1, obj* a2, obj* a3) {
+    obj * as[3] = { a1, a2, a3 };
+    return apply_borrowed(f, 3, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_4_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4) {
+    obj * as[4] = { a1, a2, a3, a4 };
+    return apply_borrowed(f, 4, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_5_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5) {
+    obj * as[5] = { a1, a2, a3, a4, a5 };
+    return apply_borrowed(f, 5, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_6_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6) {
+    obj * as[6] = { a1, a2, a3, a4, a5, a6 };
+    return apply_borrowed(f, 6, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_7_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7) {
+    obj * as[7] = { a1, a2, a3, a4, a5, a6, a7 };
+    return apply_borrowed(f, 7, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_8_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8) {
+    obj * as[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+    return apply_borrowed(f, 8, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_9_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9) {
+    obj * as[9] = { a1, a2, a3, a4, a5, a6, a7, a8, a9 };
+    return apply_borrowed(f, 9, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_10_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10) {
+    obj * as[10] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10 };
+    return apply_borrowed(f, 10, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_11_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11) {
+    obj * as[11] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11 };
+    return apply_borrowed(f, 11, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_12_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12) {
+    obj * as[12] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12 };
+    return apply_borrowed(f, 12, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_13_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13) {
+    obj * as[13] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13 };
+    return apply_borrowed(f, 13, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_14_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14) {
+    obj * as[14] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14 };
+    return apply_borrowed(f, 14, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_15_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15) {
+    obj * as[15] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15 };
+    return apply_borrowed(f, 15, as);
+}
+
+extern "C" LEAN_EXPORT obj* lean_apply_16_b(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16) {
+    obj * as[16] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16 };
+    return apply_borrowed(f, 16, as);
+}
+}
@@ -16,6 +16,11 @@ Author: Leonardo de Moura
 #ifndef LEAN_WINDOWS
 #include <sys/mman.h>
 #endif
+#ifdef LEAN_OLEAN_RANGE_CHECK
+#include <map>
+#include "runtime/thread.h"
+#include "runtime/debug.h"
+#endif
 
 #define LEAN_COMPACTOR_INIT_SZ 1024*1024
 #define LEAN_MAX_SHARING_TABLE_INITIAL_SIZE 1024*1024
@@ -35,7 +40,7 @@ struct max_sharing_hash {
     object_compactor * m;
     max_sharing_hash(object_compactor * manager):m(manager) {}
     unsigned operator()(max_sharing_key const & k) const {
-        return hash_str(k.m_size, reinterpret_cast<unsigned char const *>(m->m_begin) + k.m_offset, 17);
+        return hash_bytes(k.m_size, reinterpret_cast<unsigned char const *>(m->m_begin) + k.m_offset, 17);
     }
 };
 
@@ -232,6 +237,9 @@ bool object_compactor::insert_thunk(object * o) {
         return false;
     object * r = copy_object(o);
     lean_to_thunk(r)->m_value = c;
+    /* The closure has already been evaluated. Reset it so that the compacted region does not depend on
+       the state of the evaluation protocol (see `lean_thunk_get_core`). */
+    lean_to_thunk(r)->m_closure = nullptr;
     save_max_sharing(o, r, lean_object_byte_size(o));
     return true;
 }
@@ -361,6 +369,74 @@ void object_compactor::operator()(object * o) {
     *static_cast<object_offset *>(m_begin) = to_offset(o);
 }
 
+#ifdef LEAN_OLEAN_RANGE_CHECK
+extern "C" {
+size_t lean_olean_region_begin = 0;
+size_t lean_olean_region_size  = 0;
+}
+
+static mutex *                    g_olean_region_mutex = new mutex();
+static bool                       g_olean_region_reserved = false;
+// start -> end of the .olean files mapped in the region
+static std::map<size_t, size_t> * g_olean_region_files = new std::map<size_t, size_t>();
+
+/* Reserve the whole .olean region so that no other mapping (e.g., heap segments) is placed there.
+   If the reservation fails, `lean_in_olean_region` is always false. */
+static void reserve_olean_region() {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    void * r = mmap(reinterpret_cast<void *>(LEAN_OLEAN_REGION_BEGIN), LEAN_OLEAN_REGION_SIZE, PROT_NONE, flags, -1, 0);
+    if (r == MAP_FAILED)
+        return;
+    if (r != reinterpret_cast<void *>(LEAN_OLEAN_REGION_BEGIN)) {
+        // the address was only a hint
+        munmap(r, LEAN_OLEAN_REGION_SIZE);
+        return;
+    }
+    lean_olean_region_begin = LEAN_OLEAN_REGION_BEGIN;
+    lean_olean_region_size  = LEAN_OLEAN_REGION_SIZE;
+}
+
+static bool in_olean_region(void * addr, size_t size) {
+    size_t b = reinterpret_cast<size_t>(addr);
+    return lean_olean_region_size != 0 && b >= lean_olean_region_begin && size <= lean_olean_region_size &&
+        b - lean_olean_region_begin <= lean_olean_region_size - size;
+}
+
+void * map_olean_file(void * addr, size_t size, int fd) {
+    lock_guard<mutex> lock(*g_olean_region_mutex);
+    if (!g_olean_region_reserved) {
+        g_olean_region_reserved = true;
+        reserve_olean_region();
+    }
+    if (!in_olean_region(addr, size))
+        return mmap(addr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    size_t b = reinterpret_cast<size_t>(addr);
+    size_t e = b + size;
+    auto it = g_olean_region_files->upper_bound(b);
+    if (it != g_olean_region_files->end() && it->first < e)
+        return MAP_FAILED;
+    if (it != g_olean_region_files->begin() && std::prev(it)->second > b)
+        return MAP_FAILED;
+    // replaces the reserved (`PROT_NONE`) pages
+    void * r = mmap(addr, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (r != MAP_FAILED)
+        g_olean_region_files->insert(std::make_pair(b, e));
+    return r;
+}
+
+void unmap_olean_file(void * addr, size_t size) {
+    lock_guard<mutex> lock(*g_olean_region_mutex);
+    if (in_olean_region(addr, size) && g_olean_region_files->erase(reinterpret_cast<size_t>(addr))) {
+        lean_always_assert(mmap(addr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == addr);
+    } else {
+        lean_always_assert(munmap(addr, size) == 0);
+    }
+}
+#endif
+
 compacted_region::compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data):
     m_base_addr(base_addr),
     m_is_mmap(is_mmap),
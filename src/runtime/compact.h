@@ -55,6 +55,18 @@ public:
     void const * data() const { return m_begin; }
 };
 
+#ifdef LEAN_OLEAN_RANGE_CHECK
+/* Address range for memory-mapped .olean files. See `lean_in_olean_region`. */
+#define LEAN_OLEAN_REGION_BEGIN 0x600000000000
+#define LEAN_OLEAN_REGION_SIZE  0x1f0000000000
+
+/* Map `size` bytes of `fd` at `addr`. If `addr` is in the .olean region, make sure the new mapping does not
+   overlap with other .olean files. Return `MAP_FAILED` on failure. */
+LEAN_EXPORT void * map_olean_file(void * addr, size_t size, int fd);
+/* Unmap a file mapped with `map_olean_file`, and give the addresses back to the .olean region. */
+LEAN_EXPORT void unmap_olean_file(void * addr, size_t size);
+#endif
+
 class LEAN_EXPORT compacted_region {
     // see `object_compactor::m_base_addr`
     void * m_base_addr;
@@ -10,8 +10,17 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+/** \brief Stable hash of the given bytes.
+   Remark: `String.hash`, `ByteArray.hash`, and thus `Name.hash` are implemented using this function,
+   and their values are persisted (e.g., in .olean files and Lake trace files).
+   So, its result must not change. */
 uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value);
 
+/** \brief Fast hash of the given bytes, intended for long inputs.
+   Remark: the result is NOT stable across Lean versions or platforms. It must only be used for
+   transient data structures such as the hash-consing tables used by `sharecommon` and the compactor. */
+uint64 hash_bytes(size_t len, unsigned char const * str, uint64 init_value);
+
 inline uint64 hash(uint64 h, uint64 k) {
     uint64 m = 0xc6a4a7935bd1e995;
     uint64 r = 47;
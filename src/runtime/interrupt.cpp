@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 #include "runtime/interrupt.h"
 #include "runtime/exception.h"
 #include "runtime/memory.h"
+#include "runtime/object.h"
 #include "lean/lean.h"
 #include "util/io.h"
 
@@ -20,6 +21,8 @@ void inc_heartbeat() { g_heartbeat++; }
 
 void reset_heartbeat() { g_heartbeat = 0; }
 
+size_t get_heartbeat() { return g_heartbeat; }
+
 void set_max_heartbeat(size_t max) { g_max_heartbeat = max; }
 
 size_t get_max_heartbeat() { return g_max_heartbeat; }
@@ -34,14 +37,29 @@ void throw_heartbeat_exception() {
     throw heartbeat_exception();
 }
 
+/* Number of heartbeats between two flushes of the deferred reference counter decrements. Must be a power of two. */
+#define LEAN_DEFERRED_RC_FLUSH_PERIOD 4096
+
 void check_heartbeat() {
     inc_heartbeat();
+#ifdef LEAN_DEFERRED_MT_RC
+    if ((g_heartbeat & (LEAN_DEFERRED_RC_FLUSH_PERIOD - 1)) == 0)
+        flush_deferred_rc();
+#endif
+    if (g_max_heartbeat > 0 && g_heartbeat > g_max_heartbeat)
+        throw_heartbeat_exception();
+}
+
+void add_heartbeats(size_t n) {
+    g_heartbeat += n;
     if (g_max_heartbeat > 0 && g_heartbeat > g_max_heartbeat)
         throw_heartbeat_exception();
 }
 
 LEAN_THREAD_VALUE(lean_object *, g_cancel_tk, nullptr);
 
+lean_object * get_cancel_tk() { return g_cancel_tk; }
+
 LEAN_EXPORT scope_cancel_tk::scope_cancel_tk(lean_object * o):flet<lean_object *>(g_cancel_tk, o) {}
 
 /* CancelToken.isSet : @& IO.CancelToken → BaseIO Bool */
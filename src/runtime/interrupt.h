@@ -18,6 +18,9 @@ LEAN_EXPORT void inc_heartbeat();
 /** \brief Reset thread local counter for approximating elapsed time. */
 LEAN_EXPORT void reset_heartbeat();
 
+/** \brief Return the thread local counter for approximating elapsed time. */
+LEAN_EXPORT size_t get_heartbeat();
+
 /* Update the current heartbeat */
 class scope_heartbeat : flet<size_t> {
 public:
@@ -42,6 +45,13 @@ public:
 
 LEAN_EXPORT void check_heartbeat();
 
+/** \brief Add `n` heartbeats spent on behalf of the current thread (e.g., by tasks it waited for),
+    and throw an exception if the limit is exceeded. */
+LEAN_EXPORT void add_heartbeats(size_t n);
+
+/* Return the thread local `IO.CancelToken` (`nullptr` if unset) */
+LEAN_EXPORT lean_object * get_cancel_tk();
+
 /* Update the thread local `IO.CancelToken` (`nullptr` if unset) */
 class LEAN_EXPORT scope_cancel_tk : flet<lean_object *> {
 public:
@@ -27,6 +27,9 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #endif
 #ifndef LEAN_WINDOWS
 #include <csignal>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h> // NOLINT
 #endif
 #include <dirent.h>
 #include <fcntl.h>
@@ -36,6 +39,9 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
@@ -485,28 +491,142 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
+/*
+  Memory mapped files.
+
+  We map the file right after a page that holds the header of a `ByteArray` object, so
+  that the data of the object is the mapping itself, and reading the file requires no copy.
+  The `ByteArray` is a regular reference counted object that owns the mapping: the runtime
+  releases the mapping when the object is deallocated (see `register_mapped_sarray`).
+  The file is mapped privately and writable, so updating an exclusive array in place copies
+  the affected pages and does not modify the file. */
+
+/* Fallback for empty files and platforms where we do not map files: read `fname` into a regular `ByteArray`. */
+static obj_res read_bin_file(b_obj_arg fname) {
+    FILE * fp = fopen(lean_string_cstr(fname), "rb");
+    if (!fp)
+        return io_result_mk_error(decode_io_error(errno, fname));
+    std::string data;
+    char buffer[64 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        data.append(buffer, n);
+    bool ok = !ferror(fp);
+    fclose(fp);
+    if (!ok)
+        return io_result_mk_error(decode_io_error(EIO, fname));
+    object * r = lean_alloc_sarray(1, data.size(), data.size());
+    memcpy(lean_sarray_cptr(r), data.data(), data.size());
+    return io_result_mk_ok(r);
+}
+
+/* IO.FS.mmapBinFile : (@& FilePath) → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_mmap_bin_file(b_obj_arg fname, obj_arg /* w */) {
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    return read_bin_file(fname);
+#else
+    int fd = open(lean_string_cstr(fname), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return io_result_mk_error(decode_io_error(errno, fname));
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        // not a regular file (e.g., a pipe) or empty, `mmap` does not apply
+        close(fd);
+        return read_bin_file(fname);
+    }
+    size_t size      = st.st_size;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_size  = page_size + size;
+    char * base = static_cast<char *>(mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    if (mmap(base + page_size, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        munmap(base, map_size);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    close(fd);
+    lean_sarray_object * o = reinterpret_cast<lean_sarray_object *>(base + page_size - sizeof(lean_sarray_object));
+    lean_set_st_header(reinterpret_cast<lean_object *>(o), LeanScalarArray, 1);
+    o->m_size     = size;
+    o->m_capacity = size;
+    register_mapped_sarray(reinterpret_cast<lean_object *>(o), base, map_size);
+    return io_result_mk_ok(reinterpret_cast<lean_object *>(o));
+#endif
+}
+
+/* Reads lines from a `FILE *`, reusing the same buffer for all lines. */
+class line_reader {
+#if !defined(LEAN_WINDOWS)
+    char * m_buffer = nullptr;
+    size_t m_capacity = 0;
+#endif
+public:
+#if !defined(LEAN_WINDOWS)
+    ~line_reader() { free(m_buffer); }
+#endif
+
+    /* Read the next line of `fp`, including the line break, and return it as a Lean string.
+       Return `nullptr` if there are no more lines or an error occurred. */
+    obj_res read(FILE * fp) {
+#if defined(LEAN_WINDOWS)
+        std::string result;
+        int c; // Note: int, not char, required to handle EOF
+        while ((c = std::fgetc(fp)) != EOF) {
+            result.push_back(c);
+            if (c == '\n') {
+                break;
+            }
+        }
+        if (result.empty())
+            return nullptr;
+        return mk_string(result);
+#else
+        // `getline` scans the stdio buffer using `memchr` instead of reading one character at a time
+        ssize_t n = getline(&m_buffer, &m_capacity, fp);
+        if (n <= 0)
+            return nullptr;
+        return lean_mk_string_from_bytes(m_buffer, n);
+#endif
+    }
+};
+
 /* Handle.getLine : (@& Handle) → IO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
+    line_reader reader;
+    obj_res line = reader.read(fp);
+    if (std::ferror(fp)) {
+        if (line) lean_dec(line);
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    if (std::feof(fp))
+        clearerr(fp);
+    return io_result_mk_ok(line ? line : lean_mk_string(""));
+}
 
-    std::string result;
-    int c; // Note: int, not char, required to handle EOF
-    while ((c = std::fgetc(fp)) != EOF) {
-        result.push_back(c);
-        if (c == '\n') {
+/* Handle.getLines : (@& Handle) → USize → IO (Array String) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_lines(b_obj_arg h, usize max, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    line_reader reader;
+    object * lines = lean_mk_empty_array();
+    while (lean_array_size(lines) < max) {
+        obj_res line = reader.read(fp);
+        if (!line)
             break;
-        }
+        lines = lean_array_push(lines, line);
     }
-
     if (std::ferror(fp)) {
+        lean_dec(lines);
         return io_result_mk_error(decode_io_error(errno, nullptr));
-    } else if (std::feof(fp)) {
-        clearerr(fp);
-        return io_result_mk_ok(mk_string(result));
-    } else {
-        obj_res ret = io_result_mk_ok(mk_string(result));
-        return ret;
     }
+    if (std::feof(fp))
+        clearerr(fp);
+    return io_result_mk_ok(lines);
 }
 
 /* Handle.putStr : (@& Handle) → (@& String) → IO Unit */
@@ -521,6 +641,78 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_put_str(b_obj_arg h, b_obj_ar
     }
 }
 
+/* Below this total size, `write_many` copies the chunks into the stdio buffer instead of using `writev`. */
+static constexpr size_t g_write_many_threshold = 64 * 1024;
+
+/* Write the `n` chunks returned by `get(i)` (a pair of a pointer and a size) to `fp`.
+   If they are big enough, we flush `fp` and write them with a few `writev` system calls. */
+template<typename Get>
+static obj_res write_many(FILE * fp, size_t n, Get get) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+        total += get(i).second;
+#if !defined(LEAN_WINDOWS)
+    if (total >= g_write_many_threshold) {
+        if (std::fflush(fp) != 0)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+        int fd = fileno(fp);
+        std::vector<struct iovec> iov;
+        iov.reserve(std::min<size_t>(n, IOV_MAX));
+        size_t i = 0;
+        while (i < n) {
+            iov.clear();
+            for (; i < n && iov.size() < IOV_MAX; i++) {
+                auto c = get(i);
+                if (c.second > 0)
+                    iov.push_back({const_cast<char *>(c.first), c.second});
+            }
+            struct iovec * it  = iov.data();
+            struct iovec * end = it + iov.size();
+            while (it != end) {
+                ssize_t m = writev(fd, it, end - it);
+                if (m < 0) {
+                    if (errno == EINTR) continue;
+                    return io_result_mk_error(decode_io_error(errno, nullptr));
+                }
+                // skip the chunks that were written, and adjust the partially written one
+                size_t written = m;
+                while (it != end && written >= it->iov_len) {
+                    written -= it->iov_len;
+                    it++;
+                }
+                if (it != end) {
+                    it->iov_base = static_cast<char *>(it->iov_base) + written;
+                    it->iov_len -= written;
+                }
+            }
+        }
+        return io_result_mk_ok(box(0));
+    }
+#endif
+    for (size_t i = 0; i < n; i++) {
+        auto c = get(i);
+        if (std::fwrite(c.first, 1, c.second, fp) != c.second)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.writeMany : (@& Handle) → (@& Array ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_many(b_obj_arg h, b_obj_arg bufs, obj_arg /* w */) {
+    return write_many(io_get_handle(h), lean_array_size(bufs), [&](size_t i) {
+        object * buf = lean_array_get_core(bufs, i);
+        return std::make_pair(reinterpret_cast<char const *>(lean_sarray_cptr(buf)), lean_sarray_size(buf));
+    });
+}
+
+/* Handle.putStrMany : (@& Handle) → (@& Array String) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_put_str_many(b_obj_arg h, b_obj_arg ss, obj_arg /* w */) {
+    return write_many(io_get_handle(h), lean_array_size(ss), [&](size_t i) {
+        object * s = lean_array_get_core(ss, i);
+        return std::make_pair(lean_string_cstr(s), static_cast<size_t>(lean_string_size(s) - 1));
+    });
+}
+
 /* monoMsNow : BaseIO Nat */
 extern "C" LEAN_EXPORT obj_res lean_io_mono_ms_now(obj_arg /* w */) {
     static_assert(sizeof(std::chrono::milliseconds::rep) <= sizeof(uint64), "size of std::chrono::nanoseconds::rep may not exceed 64");
@@ -4,7 +4,23 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Markus Himmel
 */
+#include <string>
+#include <vector>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+#if defined(LEAN_WINDOWS)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
 #include "runtime/libuv.h"
+#include "runtime/object.h"
+#include "runtime/io.h"
+#include "runtime/thread.h"
 
 #ifndef LEAN_EMSCRIPTEN
 #include <uv.h>
@@ -20,3 +36,584 @@ extern "C" LEAN_EXPORT lean_obj_res lean_libuv_version(lean_obj_arg o) {
 }
 
 #endif
+
+namespace lean {
+extern "C" obj_res lean_io_promise_new(obj_arg);
+extern "C" obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg promise, obj_arg);
+
+/* Helper functions for building the `Except IO.Error α` values the asynchronous primitives resolve to. */
+
+static obj_res mk_except_ok(obj_arg v) {
+    object * r = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(r, 0, v);
+    return r;
+}
+
+static obj_res mk_except_error(obj_arg e) {
+    object * r = lean_alloc_ctor(0, 1, 0);
+    lean_ctor_set(r, 0, e);
+    return r;
+}
+
+static obj_res mk_byte_array(std::string const & data) {
+    object * r = lean_alloc_sarray(1, data.size(), data.size());
+    memcpy(lean_sarray_cptr(r), data.data(), data.size());
+    return r;
+}
+
+#if defined(LEAN_MULTI_THREAD) && !defined(LEAN_EMSCRIPTEN)
+
+/*
+  The runtime event loop.
+
+  The loop runs in a dedicated thread that is created when the first asynchronous
+  primitive is used. Other threads submit work to it using `submit`, and it wakes
+  up using `m_async`. Pending operations do not occupy task manager workers: each one
+  owns a `Promise` that the loop thread resolves when the operation completes.
+  File operations are executed by the (small) `libuv` thread pool, but operations that may wait
+  indefinitely, such as reading from a pipe, are polled by the loop thread instead.
+
+  At shutdown, pending operations are cancelled, and their promises are released without
+  being resolved. */
+struct fs_request;
+struct poll_request;
+class event_loop {
+    uv_loop_t *                                  m_loop;
+    uv_async_t                                   m_async;
+    mutex                                        m_mutex;
+    std::vector<std::function<void(uv_loop_t *)>> m_queue;
+    bool                                         m_shutting_down = false;
+    bool                                         m_finalizing = false;
+    std::unique_ptr<lthread>                     m_thread;
+    /* The pending file operations. Only accessed by the thread running the loop. */
+    std::unordered_set<fs_request *>             m_fs_requests;
+
+    static void on_async(uv_async_t * h) {
+        event_loop * self = static_cast<event_loop *>(h->data);
+        std::vector<std::function<void(uv_loop_t *)>> todo;
+        bool shutting_down;
+        {
+            unique_lock<mutex> lock(self->m_mutex);
+            todo.swap(self->m_queue);
+            shutting_down = self->m_shutting_down;
+        }
+        for (auto & fn : todo)
+            fn(self->m_loop);
+        if (shutting_down)
+            uv_stop(self->m_loop);
+    }
+
+    static void close_handle(uv_handle_t * h, void *);
+    void cancel_fs_requests();
+
+public:
+    event_loop() {
+        m_loop = new uv_loop_t;
+        lean_always_assert(uv_loop_init(m_loop) == 0);
+        m_loop->data = this;
+        lean_always_assert(uv_async_init(m_loop, &m_async, on_async) == 0);
+        m_async.data = this;
+        m_thread.reset(new lthread([this]() { uv_run(m_loop, UV_RUN_DEFAULT); }));
+    }
+
+    ~event_loop() {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_shutting_down = true;
+        }
+        uv_async_send(&m_async);
+        m_thread->join();
+        m_finalizing = true;
+        /* The loop thread is gone, we run the loop one last time to close the handles and
+           deliver the cancellations. */
+        uv_walk(m_loop, close_handle, nullptr);
+        cancel_fs_requests();
+        uv_run(m_loop, UV_RUN_NOWAIT);
+        /* `uv_loop_close` fails if a file operation is still being executed by the `libuv` thread pool.
+           Then, we leak the loop since the operation will still access it when it completes. */
+        if (uv_loop_close(m_loop) == 0)
+            delete m_loop;
+    }
+
+    static event_loop & of(uv_loop_t * loop) { return *static_cast<event_loop *>(loop->data); }
+
+    /* Return true if pending operations are being cancelled by the destructor. */
+    bool is_finalizing() const { return m_finalizing; }
+
+    void add_fs_request(fs_request * r) { m_fs_requests.insert(r); }
+    void remove_fs_request(fs_request * r) { m_fs_requests.erase(r); }
+
+    /* Execute `fn` in the event loop thread. This function is thread safe. */
+    void submit(std::function<void(uv_loop_t *)> const & fn) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_queue.push_back(fn);
+        }
+        uv_async_send(&m_async);
+    }
+};
+
+static event_loop * g_event_loop = nullptr;
+static std::once_flag * g_event_loop_once = nullptr;
+
+static event_loop & get_event_loop() {
+    std::call_once(*g_event_loop_once, []() { g_event_loop = new event_loop(); });
+    return *g_event_loop;
+}
+
+/* Create a promise and return it. The result has two references:
+   one for the `Task` returned to Lean, and one for the event loop.
+   Remark: tasks are always multi-threaded objects. */
+static object * mk_loop_promise() {
+    object * r = lean_io_promise_new(lean_io_mk_world());
+    object * promise = lean_ctor_get(r, 0);
+    lean_inc_n(promise, 2);
+    lean_dec(r);
+    return promise;
+}
+
+/* Resolve `promise` with `v`, and release the event loop reference to it. */
+static void resolve_loop_promise(object * promise, obj_arg v) {
+    lean_dec(lean_io_promise_resolve(v, promise, lean_io_mk_world()));
+    lean_dec(promise);
+}
+
+static obj_res mk_uv_error(int err, b_obj_arg fname) {
+#if defined(LEAN_WINDOWS)
+    return lean_mk_io_user_error(mk_string(uv_strerror(err)));
+#else
+    /* On Unix, libuv error codes are negated `errno` values. */
+    return decode_io_error(-err, fname);
+#endif
+}
+
+#if !defined(LEAN_WINDOWS)
+static void on_poll_close(uv_handle_t * h);
+#endif
+
+// =======================================
+// Timers
+
+struct timer_request {
+    uv_timer_t m_timer;
+    object *   m_promise;
+};
+
+static void on_timer(uv_timer_t * t) {
+    timer_request * r = static_cast<timer_request *>(t->data);
+    resolve_loop_promise(r->m_promise, box(0));
+    r->m_promise = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t *>(t), [](uv_handle_t * h) { delete static_cast<timer_request *>(h->data); });
+}
+
+/* Close a handle that is still open when the loop is finalized. */
+void event_loop::close_handle(uv_handle_t * h, void *) {
+    if (uv_is_closing(h))
+        return;
+    if (h->type == UV_TIMER) {
+        uv_close(h, [](uv_handle_t * h) {
+            timer_request * r = static_cast<timer_request *>(h->data);
+            lean_dec(r->m_promise);
+            delete r;
+        });
+#if !defined(LEAN_WINDOWS)
+    } else if (h->type == UV_POLL) {
+        uv_close(h, on_poll_close);
+#endif
+    } else {
+        uv_close(h, nullptr);
+    }
+}
+
+/* IO.sleepAsync (ms : UInt32) : BaseIO (Task Unit) */
+extern "C" LEAN_EXPORT obj_res lean_uv_sleep(uint32 ms, obj_arg) {
+    object * promise = mk_loop_promise();
+    get_event_loop().submit([=](uv_loop_t * loop) {
+        timer_request * r = new timer_request;
+        r->m_promise = promise;
+        uv_timer_init(loop, &r->m_timer);
+        r->m_timer.data = r;
+        uv_timer_start(&r->m_timer, on_timer, ms, 0);
+    });
+    return io_result_mk_ok(promise);
+}
+
+// =======================================
+// Files and pipes
+
+/*
+  State of an asynchronous `read everything`/`write everything` file operation.
+  The operation is a chain of `uv_fs_*` requests: optionally `open`, then `read`/`write`
+  until we are done, then `close`. */
+struct fs_request {
+    uv_fs_t     m_req;
+    object *    m_promise;
+    object *    m_fname;      // for error messages, may be `nullptr`
+    uv_file     m_fd = -1;
+    std::string m_data;       // data read so far, or data to be written
+    size_t      m_offset = 0; // number of bytes written so far
+    std::vector<char> m_buffer;
+    object *    m_result = nullptr;
+
+    ~fs_request() { if (m_fname) lean_dec(m_fname); }
+};
+
+void event_loop::cancel_fs_requests() {
+    for (fs_request * r : m_fs_requests)
+        uv_cancel(reinterpret_cast<uv_req_t *>(&r->m_req));
+}
+
+/* Resolve the promise with `r->m_result`, or with the error `close_err` if the operation
+   succeeded but closing the file failed. */
+static void fs_resolve(fs_request * r, int close_err) {
+    if (close_err < 0 && lean_obj_tag(r->m_result) == 1) {
+        lean_dec(r->m_result);
+        r->m_result = mk_except_error(mk_uv_error(close_err, r->m_fname));
+    }
+    event_loop & loop = event_loop::of(r->m_req.loop);
+    loop.remove_fs_request(r);
+    if (loop.is_finalizing()) {
+        lean_dec(r->m_result);
+        lean_dec(r->m_promise);
+    } else {
+        resolve_loop_promise(r->m_promise, r->m_result);
+    }
+    delete r;
+}
+
+static void on_fs_close(uv_fs_t * req) {
+    fs_request * r = static_cast<fs_request *>(req->data);
+    int err = req->result;
+    uv_fs_req_cleanup(req);
+    fs_resolve(r, err);
+}
+
+/* Close the file if it is open, and resolve the promise with `result`. */
+static void fs_finish(fs_request * r, obj_arg result) {
+    r->m_result = result;
+    if (r->m_fd >= 0) {
+        uv_loop_t * loop = r->m_req.loop;
+        if (event_loop::of(loop).is_finalizing()) {
+            // no more loop iterations, close synchronously
+            int err = uv_fs_close(loop, &r->m_req, r->m_fd, nullptr);
+            uv_fs_req_cleanup(&r->m_req);
+            fs_resolve(r, err);
+        } else {
+            int err = uv_fs_close(loop, &r->m_req, r->m_fd, on_fs_close);
+            if (err < 0)
+                fs_resolve(r, err);
+        }
+    } else {
+        fs_resolve(r, 0);
+    }
+}
+
+static void fs_read_next(fs_request * r);
+
+/* Return true if the operation must stop because the loop is being finalized. */
+static bool fs_check_finalizing(fs_request * r) {
+    if (event_loop::of(r->m_req.loop).is_finalizing()) {
+        fs_finish(r, mk_except_error(mk_uv_error(UV_ECANCELED, r->m_fname)));
+        return true;
+    }
+    return false;
+}
+
+static void on_fs_read(uv_fs_t * req) {
+    fs_request * r = static_cast<fs_request *>(req->data);
+    ssize_t n = req->result;
+    uv_fs_req_cleanup(req);
+    if (n < 0) {
+        fs_finish(r, mk_except_error(mk_uv_error(n, r->m_fname)));
+    } else if (n == 0) {
+        fs_finish(r, mk_except_ok(mk_byte_array(r->m_data)));
+    } else {
+        r->m_data.append(r->m_buffer.data(), n);
+        fs_read_next(r);
+    }
+}
+
+static void fs_read_next(fs_request * r) {
+    if (fs_check_finalizing(r))
+        return;
+    uv_buf_t buf = uv_buf_init(r->m_buffer.data(), r->m_buffer.size());
+    int err = uv_fs_read(r->m_req.loop, &r->m_req, r->m_fd, &buf, 1, -1, on_fs_read);
+    if (err < 0)
+        fs_finish(r, mk_except_error(mk_uv_error(err, r->m_fname)));
+}
+
+static void fs_write_next(fs_request * r);
+
+static void on_fs_write(uv_fs_t * req) {
+    fs_request * r = static_cast<fs_request *>(req->data);
+    ssize_t n = req->result;
+    uv_fs_req_cleanup(req);
+    if (n < 0) {
+        fs_finish(r, mk_except_error(mk_uv_error(n, r->m_fname)));
+    } else {
+        r->m_offset += n;
+        fs_write_next(r);
+    }
+}
+
+static void fs_write_next(fs_request * r) {
+    if (r->m_offset == r->m_data.size()) {
+        fs_finish(r, mk_except_ok(box(0)));
+        return;
+    }
+    if (fs_check_finalizing(r))
+        return;
+    uv_buf_t buf = uv_buf_init(&r->m_data[r->m_offset], r->m_data.size() - r->m_offset);
+    int err = uv_fs_write(r->m_req.loop, &r->m_req, r->m_fd, &buf, 1, -1, on_fs_write);
+    if (err < 0)
+        fs_finish(r, mk_except_error(mk_uv_error(err, r->m_fname)));
+}
+
+static void on_fs_open(uv_fs_t * req) {
+    fs_request * r = static_cast<fs_request *>(req->data);
+    ssize_t fd = req->result;
+    uv_fs_req_cleanup(req);
+    if (fd < 0) {
+        fs_finish(r, mk_except_error(mk_uv_error(fd, r->m_fname)));
+    } else {
+        r->m_fd = fd;
+        if (r->m_buffer.empty())
+            fs_write_next(r);
+        else
+            fs_read_next(r);
+    }
+}
+
+static constexpr size_t g_read_chunk_size = 64 * 1024;
+
+static fs_request * mk_fs_request(object * promise, b_obj_arg fname) {
+    fs_request * r = new fs_request;
+    r->m_req.data  = r;
+    r->m_promise   = promise;
+    if (fname) lean_inc(fname);
+    r->m_fname     = fname;
+    return r;
+}
+
+/* Register `r` in the event loop. It must be invoked by the loop thread before starting the operation. */
+static void fs_start(fs_request * r, uv_loop_t * loop) {
+    r->m_req.loop = loop;
+    event_loop::of(loop).add_fs_request(r);
+}
+
+/* IO.FS.readBinFileAsync (fname : @& FilePath) : BaseIO (Task (Except IO.Error ByteArray)) */
+extern "C" LEAN_EXPORT obj_res lean_uv_fs_read_file(b_obj_arg fname, obj_arg) {
+    object * promise = mk_loop_promise();
+    mark_mt(fname);
+    fs_request * r = mk_fs_request(promise, fname);
+    r->m_buffer.resize(g_read_chunk_size);
+    get_event_loop().submit([=](uv_loop_t * loop) {
+        fs_start(r, loop);
+        int err = uv_fs_open(loop, &r->m_req, string_cstr(r->m_fname), UV_FS_O_RDONLY, 0, on_fs_open);
+        if (err < 0)
+            fs_finish(r, mk_except_error(mk_uv_error(err, r->m_fname)));
+    });
+    return io_result_mk_ok(promise);
+}
+
+/* IO.FS.writeBinFileAsync (fname : @& FilePath) (content : @& ByteArray) : BaseIO (Task (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT obj_res lean_uv_fs_write_file(b_obj_arg fname, b_obj_arg content, obj_arg) {
+    object * promise = mk_loop_promise();
+    mark_mt(fname);
+    fs_request * r = mk_fs_request(promise, fname);
+    r->m_data.assign(reinterpret_cast<char const *>(lean_sarray_cptr(content)), lean_sarray_size(content));
+    get_event_loop().submit([=](uv_loop_t * loop) {
+        fs_start(r, loop);
+        int err = uv_fs_open(loop, &r->m_req, string_cstr(r->m_fname),
+                             UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC, 0666, on_fs_open);
+        if (err < 0)
+            fs_finish(r, mk_except_error(mk_uv_error(err, r->m_fname)));
+    });
+    return io_result_mk_ok(promise);
+}
+
+#if !defined(LEAN_WINDOWS)
+/*
+  State of an asynchronous `read everything` operation on a pipe (or any other pollable file descriptor).
+  The loop thread waits for the descriptor to become readable using `m_poll`, and only then reads
+  from it. So, in contrast to `uv_fs_read`, a pending read does not occupy a thread of the `libuv`
+  thread pool, which only has a few of them. */
+struct poll_request {
+    uv_poll_t         m_poll;
+    object *          m_promise;
+    int               m_fd;
+    std::string       m_data;  // data read so far
+    std::vector<char> m_buffer;
+    object *          m_result = nullptr;
+};
+
+static void on_poll_close(uv_handle_t * h) {
+    poll_request * r = static_cast<poll_request *>(h->data);
+    close(r->m_fd);
+    if (event_loop::of(h->loop).is_finalizing()) {
+        if (r->m_result)
+            lean_dec(r->m_result);
+        lean_dec(r->m_promise);
+    } else {
+        resolve_loop_promise(r->m_promise, r->m_result);
+    }
+    delete r;
+}
+
+static void poll_finish(poll_request * r, obj_arg result) {
+    r->m_result = result;
+    uv_close(reinterpret_cast<uv_handle_t *>(&r->m_poll), on_poll_close);
+}
+
+static void on_poll(uv_poll_t * p, int status, int) {
+    poll_request * r = static_cast<poll_request *>(p->data);
+    if (status < 0) {
+        poll_finish(r, mk_except_error(mk_uv_error(status, nullptr)));
+        return;
+    }
+    /* The descriptor is readable (or at the end of the stream), so `read` does not block. */
+    ssize_t n = read(r->m_fd, r->m_buffer.data(), r->m_buffer.size());
+    if (n < 0) {
+        if (errno != EINTR && errno != EAGAIN)
+            poll_finish(r, mk_except_error(decode_io_error(errno, nullptr)));
+    } else if (n == 0) {
+        poll_finish(r, mk_except_ok(mk_byte_array(r->m_data)));
+    } else {
+        r->m_data.append(r->m_buffer.data(), n);
+    }
+}
+
+/* Start polling `fd`. Return `false` if it cannot be polled (e.g., it is a regular file). */
+static bool poll_start(uv_loop_t * loop, int fd, object * promise) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !(S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) || S_ISCHR(st.st_mode)))
+        return false;
+    int flags = fcntl(fd, F_GETFL);
+    poll_request * r = new poll_request;
+    if (flags < 0 || uv_poll_init(loop, &r->m_poll, fd) != 0) {
+        delete r;
+        return false;
+    }
+    /* `uv_poll_init` sets `O_NONBLOCK`, which is shared by all descriptors of the pipe, including the one of the
+       `Handle` and the ones inherited by child processes. We restore the original flags, a blocking descriptor
+       can be polled too. */
+    fcntl(fd, F_SETFL, flags);
+    r->m_poll.data = r;
+    r->m_promise   = promise;
+    r->m_fd        = fd;
+    r->m_buffer.resize(g_read_chunk_size);
+    int err = uv_poll_start(&r->m_poll, UV_READABLE | UV_DISCONNECT, on_poll);
+    if (err < 0)
+        poll_finish(r, mk_except_error(mk_uv_error(err, nullptr)));
+    return true;
+}
+#endif
+
+/*
+  IO.FS.Handle.readToEndAsync (h : @& Handle) : BaseIO (Task (Except IO.Error ByteArray))
+
+  The event loop reads from a duplicate of the file descriptor of `h`, so `h` may be closed
+  while the operation is pending. Data already buffered by `h` is not returned, so the handle
+  should not be read synchronously before or while the operation is pending.
+
+  Remark: pipes are polled by the loop thread (see `poll_request`). We do not use a `uv_pipe_t` since it keeps
+  `O_NONBLOCK` set, which is shared by all descriptors of the pipe. Descriptors that cannot be polled, such as
+  regular files, are read using `uv_fs_read` requests. */
+extern "C" LEAN_EXPORT obj_res lean_uv_handle_read_to_end(b_obj_arg h, obj_arg) {
+    FILE * fp = static_cast<FILE *>(lean_get_external_data(h));
+    int fd = dup(fileno(fp));
+    if (fd < 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    object * promise = mk_loop_promise();
+    get_event_loop().submit([=](uv_loop_t * loop) {
+#if !defined(LEAN_WINDOWS)
+        if (poll_start(loop, fd, promise))
+            return;
+#endif
+        fs_request * r = mk_fs_request(promise, nullptr);
+        r->m_fd = fd;
+        r->m_buffer.resize(g_read_chunk_size);
+        fs_start(r, loop);
+        fs_read_next(r);
+    });
+    return io_result_mk_ok(promise);
+}
+
+void initialize_libuv() {
+    g_event_loop_once = new std::once_flag();
+}
+
+void finalize_libuv() {
+    delete g_event_loop;
+    delete g_event_loop_once;
+}
+
+#else
+
+/* Without multi-threading support, the asynchronous primitives run synchronously and return finished tasks. */
+
+extern "C" LEAN_EXPORT obj_res lean_uv_sleep(uint32 ms, obj_arg) {
+    chrono::milliseconds c(ms);
+    this_thread::sleep_for(c);
+    return io_result_mk_ok(lean_task_pure(box(0)));
+}
+
+static obj_res io_result_to_except_task(obj_arg r) {
+    object * v;
+    if (lean_io_result_is_ok(r)) {
+        v = mk_except_ok(lean_io_result_get_value(r));
+        lean_inc(lean_io_result_get_value(r));
+    } else {
+        v = mk_except_error(lean_io_result_get_error(r));
+        lean_inc(lean_io_result_get_error(r));
+    }
+    lean_dec(r);
+    return io_result_mk_ok(lean_task_pure(v));
+}
+
+extern "C" obj_res lean_io_prim_handle_mk(b_obj_arg fname, uint8 mode, obj_arg);
+extern "C" obj_res lean_io_prim_handle_read(b_obj_arg h, usize nbytes, obj_arg);
+extern "C" obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg buf, obj_arg);
+
+static obj_res read_to_end(b_obj_arg h) {
+    std::string data;
+    while (true) {
+        object * r = lean_io_prim_handle_read(h, 64 * 1024, lean_io_mk_world());
+        if (!lean_io_result_is_ok(r))
+            return r;
+        object * chunk = lean_io_result_get_value(r);
+        size_t sz = lean_sarray_size(chunk);
+        data.append(reinterpret_cast<char const *>(lean_sarray_cptr(chunk)), sz);
+        lean_dec(r);
+        if (sz == 0)
+            return io_result_mk_ok(mk_byte_array(data));
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uv_fs_read_file(b_obj_arg fname, obj_arg) {
+    object * h = lean_io_prim_handle_mk(fname, 0 /* read */, lean_io_mk_world());
+    if (!lean_io_result_is_ok(h))
+        return io_result_to_except_task(h);
+    object * r = read_to_end(lean_io_result_get_value(h));
+    lean_dec(h);
+    return io_result_to_except_task(r);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uv_fs_write_file(b_obj_arg fname, b_obj_arg content, obj_arg) {
+    object * h = lean_io_prim_handle_mk(fname, 1 /* write */, lean_io_mk_world());
+    if (!lean_io_result_is_ok(h))
+        return io_result_to_except_task(h);
+    object * r = lean_io_prim_handle_write(lean_io_result_get_value(h), content, lean_io_mk_world());
+    lean_dec(h);
+    return io_result_to_except_task(r);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uv_handle_read_to_end(b_obj_arg h, obj_arg) {
+    return io_result_to_except_task(read_to_end(h));
+}
+
+void initialize_libuv() {}
+void finalize_libuv() {}
+
+#endif
+}
@@ -8,3 +8,8 @@ Author: Markus Himmel
 #include <lean/lean.h>
 
 extern "C" LEAN_EXPORT lean_obj_res lean_libuv_version(lean_obj_arg);
+
+namespace lean {
+void initialize_libuv();
+void finalize_libuv();
+}
@@ -17,6 +17,7 @@ Revision History:
 
 --*/
 #include <stdint.h>
+#include <algorithm>
 #include "runtime/mpn.h"
 #include "runtime/debug.h"
 #include "runtime/buffer.h"
@@ -86,11 +87,10 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
+static void mpn_mul_basecase(mpn_digit const * a, size_t const lnga,
+                             mpn_digit const * b, size_t const lngb,
+                             mpn_digit * c) {
     // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
     size_t i;
     mpn_digit k;
 
@@ -148,6 +148,102 @@ public:
     }
 };
 
+/* c[0..lc) += x[0..lx), where lx <= lc. Return the carry. */
+static mpn_digit mpn_add_in_place(mpn_digit * c, size_t lc, mpn_digit const * x, size_t lx) {
+    lean_assert(lx <= lc);
+    mpn_double_digit k = 0;
+    size_t i = 0;
+    for (; i < lx; i++) {
+        k += (mpn_double_digit)c[i] + (mpn_double_digit)x[i];
+        c[i] = (mpn_digit)k;
+        k >>= DIGIT_BITS;
+    }
+    for (; k != 0 && i < lc; i++) {
+        k += (mpn_double_digit)c[i];
+        c[i] = (mpn_digit)k;
+        k >>= DIGIT_BITS;
+    }
+    return (mpn_digit)k;
+}
+
+/* c[0..lc) -= x[0..lx), where lx <= lc. Return the borrow. */
+static mpn_digit mpn_sub_in_place(mpn_digit * c, size_t lc, mpn_digit const * x, size_t lx) {
+    lean_assert(lx <= lc);
+    mpn_digit borrow = 0;
+    size_t i = 0;
+    for (; i < lx; i++) {
+        mpn_double_digit t = (mpn_double_digit)c[i] - (mpn_double_digit)x[i] - borrow;
+        c[i]   = (mpn_digit)t;
+        borrow = (t >> DIGIT_BITS) != 0;
+    }
+    for (; borrow != 0 && i < lc; i++) {
+        mpn_double_digit t = (mpn_double_digit)c[i] - borrow;
+        c[i]   = (mpn_digit)t;
+        borrow = (t >> DIGIT_BITS) != 0;
+    }
+    return borrow;
+}
+
+/* Operands with fewer digits than this are multiplied using the schoolbook method. */
+#define KARATSUBA_THRESHOLD 48
+
+static void mpn_mul_rec(mpn_digit const * a, size_t lnga,
+                        mpn_digit const * b, size_t lngb,
+                        mpn_digit * c) {
+    if (lnga < lngb) {
+        std::swap(a, b);
+        std::swap(lnga, lngb);
+    }
+    if (lngb < KARATSUBA_THRESHOLD) {
+        mpn_mul_basecase(a, lnga, b, lngb, c);
+        return;
+    }
+    size_t h = (lnga + 1) / 2;
+    if (lngb <= h) {
+        // Unbalanced operands: multiply `b` by `lngb`-digit chunks of `a`.
+        for (size_t i = 0; i < lnga + lngb; i++)
+            c[i] = 0;
+        mpn_buffer t(2*lngb);
+        for (size_t i = 0; i < lnga; i += lngb) {
+            size_t n = std::min(lngb, lnga - i);
+            mpn_mul_rec(a + i, n, b, lngb, t.data());
+            mpn_digit carry = mpn_add_in_place(c + i, lnga + lngb - i, t.data(), n + lngb);
+            lean_assert(carry == 0); (void)carry;
+        }
+        return;
+    }
+    // Karatsuba: a = a1*B^h + a0, b = b1*B^h + b0
+    // a*b = a1*b1*B^2h + ((a0 + a1)*(b0 + b1) - a0*b0 - a1*b1)*B^h + a0*b0
+    size_t lnga1 = lnga - h;
+    size_t lngb1 = lngb - h;
+    mpn_mul_rec(a, h, b, h, c);                          // c[0, 2h)            := a0*b0
+    mpn_mul_rec(a + h, lnga1, b + h, lngb1, c + 2*h);    // c[2h, lnga + lngb)  := a1*b1
+    mpn_buffer sa(h+1), sb(h+1), m(2*h+2);
+    for (size_t i = 0; i < h; i++) {
+        sa[i] = a[i];
+        sb[i] = b[i];
+    }
+    mpn_add_in_place(sa.data(), h+1, a + h, lnga1);
+    mpn_add_in_place(sb.data(), h+1, b + h, lngb1);
+    mpn_mul_rec(sa.data(), h+1, sb.data(), h+1, m.data());
+    mpn_sub_in_place(m.data(), 2*h+2, c, 2*h);
+    mpn_sub_in_place(m.data(), 2*h+2, c + 2*h, lnga1 + lngb1);
+    // The middle term fits in the remaining digits of `c`
+    size_t lngm = 2*h+2;
+    while (lngm > lnga + lngb - h) {
+        lean_assert(m[lngm-1] == 0);
+        lngm--;
+    }
+    mpn_digit carry = mpn_add_in_place(c + h, lnga + lngb - h, m.data(), lngm);
+    lean_assert(carry == 0); (void)carry;
+}
+
+void mpn_mul(mpn_digit const * a, size_t const lnga,
+             mpn_digit const * b, size_t const lngb,
+             mpn_digit * c) {
+    mpn_mul_rec(a, lnga, b, lngb, c);
+}
+
 static size_t div_normalize(mpn_digit const * numer, size_t const lnum,
                             mpn_digit const * denom, size_t const lden,
                             mpn_buffer & n_numer,
@@ -329,21 +425,39 @@ char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t c
 #endif
     }
     else {
-        mpn_buffer temp(lng, 0), t_numer(lng+1, 0), t_denom(1, 0);
+        mpn_buffer temp(lng, 0);
         for (unsigned i = 0; i < lng; i++)
             temp[i] = a[i];
+        while (!temp.empty() && temp.back() == 0)
+            temp.pop_back();
 
+        // Divide by 10^9 in each pass, and produce 9 decimal digits at a time
+        static const mpn_digit chunk = 1000000000;
         size_t j = 0;
-        mpn_digit rem;
-        mpn_digit ten = 10;
-        while (!temp.empty() && (temp.size() > 1 || temp[0] != 0)) {
-            size_t d = div_normalize(&temp[0], temp.size(), &ten, 1, t_numer, t_denom);
-            div_1(t_numer, t_denom[0], &temp[0]);
-            div_unnormalize(t_numer, t_denom, d, &rem);
-            buf[j++] = '0' + rem;
+        while (!temp.empty()) {
+            mpn_double_digit rem = 0;
+            for (size_t i = temp.size(); i-- > 0; ) {
+                mpn_double_digit t = (rem << DIGIT_BITS) | (mpn_double_digit)temp[i];
+                temp[i] = (mpn_digit)(t / chunk);
+                rem     = t % chunk;
+            }
             while (!temp.empty() && temp.back() == 0)
                 temp.pop_back();
+            if (temp.empty()) {
+                // most significant chunk, no leading zeros
+                while (rem != 0) {
+                    buf[j++] = '0' + rem % 10;
+                    rem /= 10;
+                }
+            } else {
+                for (unsigned k = 0; k < 9; k++) {
+                    buf[j++] = '0' + rem % 10;
+                    rem /= 10;
+                }
+            }
         }
+        if (j == 0)
+            buf[j++] = '0';
         buf[j] = 0;
 
         j--;
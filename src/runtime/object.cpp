@@ -9,6 +9,9 @@ Author: Leonardo de Moura
 #include <vector>
 #include <deque>
 #include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <unordered_map>
 #include <lean/lean.h>
 #include "runtime/object.h"
 #include "runtime/thread.h"
@@ -26,6 +29,9 @@ Author: Leonardo de Moura
 #include <execinfo.h>
 #include <unistd.h>
 #endif
+#if !defined(LEAN_WINDOWS)
+#include <sys/mman.h>
+#endif
 
 // HACK: for unknown reasons, std::isnan(x) fails on msys64 because math.h
 // is imported and isnan(x) looks like a macro. On the other hand, isnan(x)
@@ -142,11 +148,41 @@ extern "C" LEAN_EXPORT object * lean_sorry(uint8) {
     lean_unreachable();
 }
 
+#ifdef LEAN_RUNTIME_STATS
+static atomic<uint64> g_num_persistent_inc(0);
+static atomic<uint64> g_num_persistent_dec(0);
+struct persistent_rc_stats {
+    ~persistent_rc_stats() {
+        std::cerr << "num. persistent inc.:" << g_num_persistent_inc << "\n";
+        std::cerr << "num. persistent dec.:" << g_num_persistent_dec << "\n";
+    }
+};
+static persistent_rc_stats g_persistent_rc_stats;
+
+extern "C" LEAN_EXPORT void lean_stat_persistent_rc_op(bool is_dec) {
+    if (is_dec)
+        g_num_persistent_dec.fetch_add(1, std::memory_order_relaxed);
+    else
+        g_num_persistent_inc.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+#ifdef LEAN_DEFERRED_MT_RC
+static unsigned deferred_rc_cancel(object * o, unsigned n);
+#endif
+
 extern "C" LEAN_EXPORT void lean_inc_ref_cold(lean_object * o) {
+#ifdef LEAN_DEFERRED_MT_RC
+    if (deferred_rc_cancel(o, 1) == 1) return;
+#endif
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_relaxed);
 }
 
 extern "C" LEAN_EXPORT void lean_inc_ref_n_cold(lean_object * o, unsigned n) {
+#ifdef LEAN_DEFERRED_MT_RC
+    n -= deferred_rc_cancel(o, n);
+    if (n == 0) return;
+#endif
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), (int)n, std::memory_order_relaxed);
 }
 
@@ -180,10 +216,53 @@ static inline void lean_dealloc(lean_object * o, size_t sz) {
 #endif
 }
 
+/*
+  Scalar arrays whose data is a memory mapping (see `lean_io_mmap_bin_file`). They are regular reference counted
+  objects, and the mapping is released when they are deallocated. We cannot mark them in the object header since
+  it is overwritten when the object is put in the deletion TODO list, so we keep track of their addresses.
+  `g_num_mapped_sarrays` allows us to skip the lookup when there are no mapped arrays.
+*/
+static std::atomic<size_t>                                      g_num_mapped_sarrays(0);
+static mutex *                                                   g_mapped_sarrays_mutex = new mutex();
+static std::unordered_map<object *, std::pair<void *, size_t>> * g_mapped_sarrays =
+    new std::unordered_map<object *, std::pair<void *, size_t>>();
+
+void register_mapped_sarray(object * o, void * base, size_t size) {
+    lock_guard<mutex> lock(*g_mapped_sarrays_mutex);
+    g_mapped_sarrays->insert(std::make_pair(o, std::make_pair(base, size)));
+    g_num_mapped_sarrays++;
+}
+
+/* Release the mapping if `o` is a mapped scalar array, and return `true` in this case. */
+static bool free_mapped_sarray(object * o) {
+    void * base;
+    size_t size;
+    {
+        lock_guard<mutex> lock(*g_mapped_sarrays_mutex);
+        auto it = g_mapped_sarrays->find(o);
+        if (it == g_mapped_sarrays->end())
+            return false;
+        base = it->second.first;
+        size = it->second.second;
+        g_mapped_sarrays->erase(it);
+        g_num_mapped_sarrays--;
+    }
+#if !defined(LEAN_WINDOWS)
+    munmap(base, size);
+#endif
+    return true;
+}
+
+static inline void lean_dealloc_sarray(lean_object * o) {
+    if (LEAN_UNLIKELY(g_num_mapped_sarrays.load(std::memory_order_relaxed) > 0) && free_mapped_sarray(o))
+        return;
+    lean_dealloc(o, lean_sarray_byte_size(o));
+}
+
 extern "C" LEAN_EXPORT void lean_free_object(lean_object * o) {
     switch (lean_ptr_tag(o)) {
     case LeanArray:       return lean_dealloc(o, lean_array_byte_size(o));
-    case LeanScalarArray: return lean_dealloc(o, lean_sarray_byte_size(o));
+    case LeanScalarArray: return lean_dealloc_sarray(o);
     case LeanString:      return lean_dealloc(o, lean_string_byte_size(o));
     case LeanMPZ:         to_mpz(o)->m_value.~mpz(); return lean_free_small_object(o);
     default:              return lean_free_small_object(o);
@@ -288,7 +367,7 @@ static void lean_del_core(object * o, object * & todo) {
             break;
         }
         case LeanScalarArray:
-            lean_dealloc(o, lean_sarray_byte_size(o));
+            lean_dealloc_sarray(o);
             break;
         case LeanString:
             lean_dealloc(o, lean_string_byte_size(o));
@@ -319,20 +398,166 @@ static void lean_del_core(object * o, object * & todo) {
     }
 }
 
-extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
-    if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
+/* Free `o` and the objects that become unreachable. Pre: the RC of `o` has dropped to zero. */
+static void lean_del(object * o) {
 #ifdef LEAN_LAZY_RC
-        push_back(g_to_free, o);
+    push_back(g_to_free, o);
 #else
-        object * todo = nullptr;
-        while (true) {
-            lean_del_core(o, todo);
-            if (todo == nullptr)
-                return;
-            o = pop_back(todo);
+    object * todo = nullptr;
+    while (true) {
+        lean_del_core(o, todo);
+        if (todo == nullptr)
+            return;
+        o = pop_back(todo);
+    }
+#endif
+}
+
+#ifdef LEAN_DEFERRED_MT_RC
+/* Deferred reference counting for multi-threaded objects.
+
+   Decrements of MT objects are not applied immediately. Instead, each thread records them in a small
+   direct-mapped table, where repeated decrements of the same object are coalesced into a single atomic operation.
+   Moreover, an increment of an object with pending decrements just cancels one of them, and does not touch the
+   shared cache line at all. Deferring decrements is safe since it only delays the deallocation of objects the thread
+   still holds references to.
+
+   Pending decrements are applied when a slot is needed for another object, and at safepoints: after a task finishes,
+   every `LEAN_DEFERRED_RC_FLUSH_PERIOD` heartbeats, and at thread finalization. See `flush_deferred_rc`. */
+#define LEAN_DEFERRED_RC_SLOTS      256
+#define LEAN_DEFERRED_RC_MAX_DECS   (1u << 30)
+
+struct deferred_rc_slot {
+    object * m_obj{nullptr};
+    unsigned m_num_decs{0};
+};
+
+struct deferred_rc_table {
+    deferred_rc_slot m_slots[LEAN_DEFERRED_RC_SLOTS];
+};
+
+LEAN_THREAD_PTR(deferred_rc_table, g_deferred_rc);
+
+static inline deferred_rc_slot & get_deferred_rc_slot(deferred_rc_table * t, object * o) {
+    return t->m_slots[(reinterpret_cast<size_t>(o) / LEAN_OBJECT_SIZE_DELTA) % LEAN_DEFERRED_RC_SLOTS];
+}
+
+/* Objects freed by applying deferred decrements. Finalizers of external objects and tasks may reenter
+   `lean_dec_ref_cold`, and evict other slots. So, we free the objects in the outermost `apply_deferred_decs` call
+   instead of recursing, which could overflow the stack on long chains. */
+LEAN_THREAD_PTR(object, g_deferred_rc_to_free);
+LEAN_THREAD_VALUE(bool, g_deferred_rc_freeing, false);
+
+static void apply_deferred_decs(object * o, unsigned n) {
+    // `o` may have been made persistent in the meantime
+    if (lean_get_rc_mt_addr(o)->load(std::memory_order_relaxed) == 0)
+        return;
+    if (std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), (int)n, std::memory_order_acq_rel) == -(int)n) {
+        push_back(g_deferred_rc_to_free, o);
+        if (!g_deferred_rc_freeing) {
+            flet<bool> freeing(g_deferred_rc_freeing, true);
+            while (g_deferred_rc_to_free != nullptr)
+                lean_del(pop_back(g_deferred_rc_to_free));
         }
+    }
+}
+
+/* Apply the pending decrements of `t` until it is empty. */
+static void flush_deferred_rc_table(deferred_rc_table * t) {
+    bool found;
+    do {
+        // freeing objects may store new pending decrements in slots we have already visited
+        found = false;
+        for (deferred_rc_slot & s : t->m_slots) {
+            while (object * o = s.m_obj) {
+                unsigned n   = s.m_num_decs;
+                s.m_obj      = nullptr;
+                s.m_num_decs = 0;
+                found        = true;
+                apply_deferred_decs(o, n);
+            }
+        }
+    } while (found);
+}
+
+static void finalize_deferred_rc(void *) {
+    deferred_rc_table * t = g_deferred_rc;
+    /* Decrements performed while flushing are applied immediately since we are finalizing the thread,
+       see `deferred_rc_dec`. */
+    g_deferred_rc = nullptr;
+    if (t != nullptr) {
+        flush_deferred_rc_table(t);
+        delete t;
+    }
+}
+
+/* Return `true` if the decrement has been deferred. */
+static bool deferred_rc_dec(object * o) {
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag == LeanTask || tag == LeanExternal) {
+        // tasks must be deactivated and external objects finalized promptly
+        return false;
+    }
+    deferred_rc_table * t = g_deferred_rc;
+    if (LEAN_UNLIKELY(t == nullptr)) {
+        if (in_thread_finalization())
+            return false;
+        t = new deferred_rc_table();
+        g_deferred_rc = t;
+        register_thread_finalizer(finalize_deferred_rc, nullptr);
+    }
+    deferred_rc_slot & s = get_deferred_rc_slot(t, o);
+    if (s.m_obj == o) {
+        if (LEAN_UNLIKELY(s.m_num_decs == LEAN_DEFERRED_RC_MAX_DECS))
+            return false;
+        s.m_num_decs++;
+    } else {
+        object * old     = s.m_obj;
+        unsigned old_n   = s.m_num_decs;
+        s.m_obj          = o;
+        s.m_num_decs     = 1;
+        /* Remark: the slot must be updated before applying the old decrements since freeing objects may
+           reenter `lean_dec_ref_cold`. */
+        if (old != nullptr)
+            apply_deferred_decs(old, old_n);
+    }
+    return true;
+}
+
+/* Cancel up to `n` pending decrements of `o`, and return the number of decrements canceled. */
+static unsigned deferred_rc_cancel(object * o, unsigned n) {
+    deferred_rc_table * t = g_deferred_rc;
+    if (t == nullptr)
+        return 0;
+    deferred_rc_slot & s = get_deferred_rc_slot(t, o);
+    if (s.m_obj != o)
+        return 0;
+    unsigned k = std::min(n, s.m_num_decs);
+    s.m_num_decs -= k;
+    if (s.m_num_decs == 0)
+        s.m_obj = nullptr;
+    return k;
+}
+
+void flush_deferred_rc() {
+    if (deferred_rc_table * t = g_deferred_rc)
+        flush_deferred_rc_table(t);
+}
+#else
+void flush_deferred_rc() {}
 #endif
+
+extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
+    if (o->m_rc == 1) {
+        lean_del(o);
+        return;
     }
+#ifdef LEAN_DEFERRED_MT_RC
+    if (deferred_rc_dec(o))
+        return;
+#endif
+    if (std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1)
+        lean_del(o);
 }
 
 
@@ -386,35 +611,114 @@ extern "C" LEAN_EXPORT lean_obj_res lean_array_set_panic(lean_obj_arg a, lean_ob
 // =======================================
 // Thunks
 
-extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
-    object * c = lean_to_thunk(t)->m_closure.exchange(nullptr);
-    if (c != nullptr) {
-        /* Recall that a closure uses the standard calling convention.
-           `thunk_get` "consumes" the result `r` by storing it at `to_thunk(t)->m_value`.
-           Then, it returns a reference to this result to the caller.
-           The behavior is compatible with `cnstr_obj` with also returns a reference
-           to be object stored in the constructor object.
-
-           Recall that `apply_1` also consumes `c`'s RC. */
-        object * r = lean_apply_1(c, lean_box(0));
-        lean_assert(r != nullptr); /* Closure must return a valid lean object */
-        lean_assert(lean_to_thunk(t)->m_value == nullptr);
-        mark_mt(r);
-        lean_to_thunk(t)->m_value = r;
-        return r;
-    } else {
-        lean_assert(c == nullptr);
-        /* There is another thread executing the closure. We keep waiting for the m_value to be
-           set by another thread. */
-        while (!lean_to_thunk(t)->m_value) {
-            this_thread::yield();
+/* Thunk evaluation protocol.
+
+   `m_closure` is the closure to be evaluated, `nullptr` if some thread has claimed it, or
+   `g_thunk_waiting` if some thread has claimed it and at least one other thread is waiting for the result.
+   The first thread to force the thunk claims the closure using a CAS. Other threads announce themselves by
+   replacing `nullptr` with `g_thunk_waiting`, and block on one of the `g_thunk_parking` slots until the value is
+   available. The forcing thread only touches the parking slot if someone announced themselves.
+   A thread that announces itself after the forcing thread has reset `m_closure` finds `m_value` set, and
+   resets `m_closure` again. Thus, `m_closure` is `nullptr` once the value is available and all
+   `lean_thunk_get_core` calls have returned (e.g., when the thunk is compacted). */
+static object * const g_thunk_waiting = lean_box(0);
+
+#define LEAN_THUNK_PARKING_SLOTS 64
+
+struct thunk_parking_slot {
+    mutex              m_mutex;
+    condition_variable m_cv;
+};
+
+static thunk_parking_slot g_thunk_parking[LEAN_THUNK_PARKING_SLOTS];
+
+static thunk_parking_slot & get_thunk_parking_slot(object * t) {
+    return g_thunk_parking[(reinterpret_cast<size_t>(t) / sizeof(lean_thunk_object)) % LEAN_THUNK_PARKING_SLOTS];
+}
+
+#ifdef LEAN_RUNTIME_STATS
+static atomic<uint64> g_num_thunk_eval(0);
+static atomic<uint64> g_num_thunk_contended(0);
+static atomic<uint64> g_num_thunk_parked(0);
+struct thunk_stats {
+    ~thunk_stats() {
+        std::cerr << "num. thunk eval.:    " << g_num_thunk_eval << "\n";
+        std::cerr << "num. thunk contended:" << g_num_thunk_contended << "\n";
+        std::cerr << "num. thunk parked:   " << g_num_thunk_parked << "\n";
+    }
+};
+static thunk_stats g_thunk_stats;
+#define LEAN_THUNK_STAT(c) c
+#else
+#define LEAN_THUNK_STAT(c)
+#endif
+
+static object * thunk_wait(b_obj_arg t) {
+    LEAN_THUNK_STAT(g_num_thunk_contended++);
+    object * c = nullptr;
+    /* Announce that we are waiting. If the CAS fails, then either another thread has already done it,
+       or the value has been set and the closure reset. In both cases, it is safe to check `m_value` below. */
+    bool announced = lean_to_thunk(t)->m_closure.compare_exchange_strong(c, g_thunk_waiting);
+    if (object * r = lean_to_thunk(t)->m_value) {
+        if (announced) {
+            /* We may have announced ourselves after the forcing thread reset `m_closure`. */
+            c = g_thunk_waiting;
+            lean_to_thunk(t)->m_closure.compare_exchange_strong(c, nullptr);
         }
-        return lean_to_thunk(t)->m_value;
+        return r;
+    }
+    thunk_parking_slot & slot = get_thunk_parking_slot(t);
+    unique_lock<mutex> lock(slot.m_mutex);
+    while (!lean_to_thunk(t)->m_value) {
+        LEAN_THUNK_STAT(g_num_thunk_parked++);
+        slot.m_cv.wait(lock);
     }
+    return lean_to_thunk(t)->m_value;
+}
+
+extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
+    object * c = lean_to_thunk(t)->m_closure;
+    if (c == nullptr || c == g_thunk_waiting || !lean_to_thunk(t)->m_closure.compare_exchange_strong(c, nullptr)) {
+        /* There is another thread executing the closure. */
+        return thunk_wait(t);
+    }
+    LEAN_THUNK_STAT(g_num_thunk_eval++);
+    /* Recall that a closure uses the standard calling convention.
+       `thunk_get` "consumes" the result `r` by storing it at `to_thunk(t)->m_value`.
+       Then, it returns a reference to this result to the caller.
+       The behavior is compatible with `cnstr_obj` with also returns a reference
+       to be object stored in the constructor object.
+
+       Recall that `apply_1` also consumes `c`'s RC. */
+    object * r = lean_apply_1(c, lean_box(0));
+    lean_assert(r != nullptr); /* Closure must return a valid lean object */
+    lean_assert(lean_to_thunk(t)->m_value == nullptr);
+    mark_mt(r);
+    lean_to_thunk(t)->m_value = r;
+    if (lean_to_thunk(t)->m_closure.exchange(nullptr) == g_thunk_waiting) {
+        /* Taking the lock makes sure every waiter either has seen `m_value` or is blocked in `wait`. */
+        thunk_parking_slot & slot = get_thunk_parking_slot(t);
+        unique_lock<mutex> lock(slot.m_mutex);
+        slot.m_cv.notify_all();
+    }
+    return r;
 }
 
 // =======================================
-// Mark Persistent
+// Mark Persistent and Mark MT
+
+/* `lean_mark_persistent` and `lean_mark_mt` update the `m_rc` field of every object reachable from a given root.
+   The new value of `m_rc` doubles as the visited mark: persistent objects have `m_rc == 0` and MT objects have
+   `m_rc < 0`, and the traversal does not visit the children of objects that are already marked.
+
+   When the graph is big (more than `LEAN_MARK_PARALLEL_THRESHOLD` objects), the remaining work is split across helper
+   threads. In this case, objects are claimed using a CAS on `m_rc`, and threads hand chunks of their
+   pending objects to idle threads. The children of external objects are only visited after the helper
+   threads are done: `m_foreach` updates the reference counters of the children non-atomically, which
+   would race with the CAS operations of the other threads. */
+#define LEAN_MARK_PARALLEL_THRESHOLD (1u << 16)
+#define LEAN_MARK_CHUNK_SIZE         512
+#define LEAN_MARK_MAX_WORKERS        8
 
 extern "C" void lean_mark_persistent(object * o);
 
@@ -423,87 +727,267 @@ static obj_res mark_persistent_fn(obj_arg o) {
     return lean_box(0);
 }
 
+extern "C" void lean_mark_mt(object * o);
+
+static obj_res mark_mt_fn(obj_arg o) {
+    lean_mark_mt(o);
+    lean_dec(o);
+    return lean_box(0);
+}
+
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
 #include <sanitizer/lsan_interface.h>
 #endif
 #endif
 
-extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
-    buffer<object*> todo;
-    todo.push_back(o);
-    while (!todo.empty()) {
-        object * o = todo.back();
-        todo.pop_back();
-        if (!lean_is_scalar(o) && lean_has_rc(o)) {
+enum class mark_kind { Persistent, MT };
+
+#ifdef LEAN_RUNTIME_STATS
+static atomic<uint64> g_mark_persistent_ns(0);
+static atomic<uint64> g_mark_mt_ns(0);
+static atomic<uint64> g_num_marked(0);
+static atomic<uint64> g_num_parallel_marks(0);
+struct mark_stats {
+    ~mark_stats() {
+        std::cerr << "mark persistent (ms):" << g_mark_persistent_ns / 1000000 << "\n";
+        std::cerr << "mark MT (ms):        " << g_mark_mt_ns / 1000000 << "\n";
+        std::cerr << "num. marked objects: " << g_num_marked << "\n";
+        std::cerr << "num. parallel marks: " << g_num_parallel_marks << "\n";
+    }
+};
+static mark_stats g_mark_stats;
+class mark_timer {
+    atomic<uint64> &                      m_ns;
+    std::chrono::steady_clock::time_point m_start;
+public:
+    mark_timer(atomic<uint64> & ns):m_ns(ns), m_start(std::chrono::steady_clock::now()) {}
+    ~mark_timer() {
+        m_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+#define LEAN_MARK_STAT(c) c
+#else
+#define LEAN_MARK_STAT(c)
+#endif
+
+/* Mark `o`, and return `true` if its children must be visited. */
+template<mark_kind K, bool Atomic>
+static inline bool mark_object(object * o) {
+    if (lean_is_scalar(o))
+        return false;
+    if (K == mark_kind::MT) {
+        if (Atomic) {
+            int rc = lean_get_rc_mt_addr(o)->load(std::memory_order_relaxed);
+            do {
+                if (rc <= 0) return false;
+            } while (!lean_get_rc_mt_addr(o)->compare_exchange_weak(rc, -rc, std::memory_order_relaxed));
+        } else {
+            if (!lean_is_st(o)) return false;
+            o->m_rc = -o->m_rc;
+        }
+    } else {
+        if (Atomic) {
+            int rc = lean_get_rc_mt_addr(o)->load(std::memory_order_relaxed);
+            do {
+                if (rc == 0) return false;
+            } while (!lean_get_rc_mt_addr(o)->compare_exchange_weak(rc, 0, std::memory_order_relaxed));
+        } else {
+            if (!lean_has_rc(o)) return false;
             o->m_rc = 0;
+        }
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
-            // do not report as leak
-            // NOTE: Most persistent objects are actually reachable from global
-            // variables up to the end of the process. However, this is *not*
-            // true for closures inside of persistent thunks, which are
-            // "orphaned" after being evaluated.
-            __lsan_ignore_object(o);
+        // do not report as leak
+        // NOTE: Most persistent objects are actually reachable from global
+        // variables up to the end of the process. However, this is *not*
+        // true for closures inside of persistent thunks, which are
+        // "orphaned" after being evaluated.
+        __lsan_ignore_object(o);
 #endif
 #endif
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_persistent_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
+    }
+    LEAN_MARK_STAT(g_num_marked++);
+    return true;
+}
+
+/* Mark the children of the external object `o` using nested traversals. */
+template<mark_kind K>
+static void mark_external_children(object * o) {
+    object * fn = lean_alloc_closure(K == mark_kind::MT ? (void*)mark_mt_fn : (void*)mark_persistent_fn, 1, 0);
+    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
+    lean_dec(fn);
+}
+
+template<mark_kind K, typename Todo>
+static void push_children(object * o, Todo & todo) {
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag <= LeanMaxCtorTag) {
+        object ** it  = lean_ctor_obj_cptr(o);
+        object ** end = it + lean_ctor_num_objs(o);
+        for (; it != end; ++it) todo.push_back(*it);
+    } else {
+        switch (tag) {
+        case LeanScalarArray:
+        case LeanString:
+        case LeanMPZ:
+            break;
+        case LeanExternal:
+            mark_external_children<K>(o);
+            break;
+        case LeanTask:
+            todo.push_back(lean_task_get(o));
+            break;
+        case LeanClosure: {
+            object ** it  = lean_closure_arg_cptr(o);
+            object ** end = it + lean_closure_num_fixed(o);
+            for (; it != end; ++it) todo.push_back(*it);
+            break;
+        }
+        case LeanArray: {
+            object ** it  = lean_array_cptr(o);
+            object ** end = it + lean_array_size(o);
+            for (; it != end; ++it) todo.push_back(*it);
+            break;
+        }
+        case LeanThunk:
+            if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
+            if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
+            break;
+        case LeanRef:
+            if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
+            break;
+        default:
+            lean_unreachable();
+            break;
+        }
+    }
+}
+
+/* Process `todo` until it is empty or `budget` objects have been marked. */
+template<mark_kind K, bool Atomic, typename Todo>
+static void mark_loop(Todo & todo, size_t budget) {
+    while (!todo.empty() && budget > 0) {
+        object * o = todo.back();
+        todo.pop_back();
+        if (mark_object<K, Atomic>(o)) {
+            push_children<K>(o, todo);
+            budget--;
+        }
+    }
+}
+
+#if defined(LEAN_MULTI_THREAD)
+class mark_workers {
+    mutex                              m_mutex;
+    condition_variable                 m_cv;
+    std::vector<std::vector<object*>>  m_chunks;
+    std::vector<object*>               m_externals;
+    unsigned                           m_num_workers;
+    atomic<unsigned>                   m_num_idle{0};
+public:
+    mark_workers(unsigned num_workers):m_num_workers(num_workers) {}
+
+    bool has_idle() const { return m_num_idle.load(std::memory_order_relaxed) > 0; }
+
+    void add(std::vector<object*> && chunk) {
+        unique_lock<mutex> lock(m_mutex);
+        m_chunks.push_back(std::move(chunk));
+        m_cv.notify_one();
+    }
+
+    /* Postpone visiting the children of the marked external object `o`. */
+    void add_external(object * o) {
+        unique_lock<mutex> lock(m_mutex);
+        m_externals.push_back(o);
+    }
+
+    std::vector<object*> const & externals() const { return m_externals; }
+
+    /* Retrieve the next chunk. Return `false` if all workers are idle and there is no pending work. */
+    bool next(std::vector<object*> & todo) {
+        unique_lock<mutex> lock(m_mutex);
+        m_num_idle++;
+        while (m_chunks.empty()) {
+            if (m_num_idle == m_num_workers) {
+                m_cv.notify_all();
+                return false;
+            }
+            m_cv.wait(lock);
+        }
+        m_num_idle--;
+        todo = std::move(m_chunks.back());
+        m_chunks.pop_back();
+        return true;
+    }
+};
+
+template<mark_kind K>
+static void mark_worker(mark_workers & w) {
+    std::vector<object*> todo;
+    while (w.next(todo)) {
+        while (!todo.empty()) {
+            object * o = todo.back();
+            todo.pop_back();
+            if (mark_object<K, true>(o)) {
+                if (lean_ptr_tag(o) == LeanExternal)
+                    w.add_external(o);
+                else
+                    push_children<K>(o, todo);
+            }
+            if (todo.size() >= 2*LEAN_MARK_CHUNK_SIZE && w.has_idle()) {
+                /* hand the oldest pending objects to an idle worker, we move them to the back first
+                   since the order of `todo` does not matter */
+                std::swap_ranges(todo.begin(), todo.begin() + LEAN_MARK_CHUNK_SIZE, todo.end() - LEAN_MARK_CHUNK_SIZE);
+                w.add(std::vector<object*>(todo.end() - LEAN_MARK_CHUNK_SIZE, todo.end()));
+                todo.resize(todo.size() - LEAN_MARK_CHUNK_SIZE);
             }
         }
     }
 }
 
-// =======================================
-// Mark MT
+template<mark_kind K>
+static void mark_parallel(buffer<object*> & todo) {
+    unsigned num_workers = std::min(hardware_concurrency(), static_cast<unsigned>(LEAN_MARK_MAX_WORKERS));
+    if (num_workers <= 1) {
+        mark_loop<K, false>(todo, std::numeric_limits<size_t>::max());
+        return;
+    }
+    LEAN_MARK_STAT(g_num_parallel_marks++);
+    mark_workers w(num_workers);
+    std::vector<std::vector<object*>> chunks(num_workers);
+    for (unsigned i = 0; i < todo.size(); i++)
+        chunks[i % num_workers].push_back(todo[i]);
+    for (auto & chunk : chunks)
+        if (!chunk.empty()) w.add(std::move(chunk));
+    std::vector<std::unique_ptr<lthread>> helpers;
+    for (unsigned i = 1; i < num_workers; i++)
+        helpers.emplace_back(new lthread([&]() { mark_worker<K>(w); }));
+    mark_worker<K>(w);
+    for (auto & h : helpers)
+        h->join();
+    /* The nested traversals may be parallel as well. */
+    for (object * o : w.externals())
+        mark_external_children<K>(o);
+}
+#endif
 
-extern "C" void lean_mark_mt(object * o);
+template<mark_kind K>
+static void mark_core(object * o) {
+    buffer<object*> todo;
+    todo.push_back(o);
+    LEAN_MARK_STAT(mark_timer timer(K == mark_kind::MT ? g_mark_mt_ns : g_mark_persistent_ns));
+#if defined(LEAN_MULTI_THREAD)
+    mark_loop<K, false>(todo, LEAN_MARK_PARALLEL_THRESHOLD);
+    if (!todo.empty())
+        mark_parallel<K>(todo);
+#else
+    mark_loop<K, false>(todo, std::numeric_limits<size_t>::max());
+#endif
+}
 
-static obj_res mark_mt_fn(obj_arg o) {
-    lean_mark_mt(o);
-    lean_dec(o);
-    return lean_box(0);
+extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
+    mark_core<mark_kind::Persistent>(o);
 }
 
 extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
@@ -511,60 +995,7 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
     return;
 #endif
     if (lean_is_scalar(o) || !lean_is_st(o)) return;
-
-    buffer<object*> todo;
-    todo.push_back(o);
-    while (!todo.empty()) {
-        object * o = todo.back();
-        todo.pop_back();
-        if (!lean_is_scalar(o) && lean_is_st(o)) {
-            o->m_rc = -o->m_rc;
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_mt_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
-            }
-        }
-    }
+    mark_core<mark_kind::MT>(o);
 }
 
 // =======================================
@@ -718,6 +1149,8 @@ class task_manager {
             if (v != nullptr && t->m_imp->m_keep_alive) {
                 lean_dec_ref((lean_object*)t);
             }
+            // task boundaries are safepoints for deferred reference counting
+            flush_deferred_rc();
             lock.lock();
         }
         lean_assert(t->m_imp);
@@ -1101,6 +1534,14 @@ object * alloc_mpz(mpz const & m) {
     return (lean_object*)o;
 }
 
+/* Remark: we use this overload for temporaries to reuse their digits instead of copying them. */
+object * alloc_mpz(mpz && m) {
+    void * mem = lean_alloc_small_object(sizeof(mpz_object));
+    mpz_object * o = new (mem) mpz_object(std::move(m));
+    lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+    return (lean_object*)o;
+}
+
 #ifdef LEAN_USE_GMP
 extern "C" LEAN_EXPORT lean_object * lean_alloc_mpz(mpz_t v) {
     return alloc_mpz(mpz(v));
@@ -1116,6 +1557,11 @@ object * mpz_to_nat_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
+object * mpz_to_nat_core(mpz && m) {
+    lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
+    return alloc_mpz(std::move(m));
+}
+
 static inline obj_res mpz_to_nat(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
         return lean_box(m.get_size_t());
@@ -1123,6 +1569,13 @@ static inline obj_res mpz_to_nat(mpz const & m) {
         return mpz_to_nat_core(m);
 }
 
+static inline obj_res mpz_to_nat(mpz && m) {
+    if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
+        return lean_box(m.get_size_t());
+    else
+        return mpz_to_nat_core(std::move(m));
+}
+
 extern "C" LEAN_EXPORT object * lean_cstr_to_nat(char const * n) {
     return mpz_to_nat(mpz(n));
 }
@@ -1183,6 +1636,72 @@ extern "C" LEAN_EXPORT object * lean_nat_big_mul(object * a1, object * a2) {
         return mpz_to_nat_core(mpz_value(a1) * mpz_value(a2));
 }
 
+/*
+  In-place variants of `lean_nat_big_add/sub/mul`.
+  They take ownership of `a1`, and update it in place if it is an exclusive big number.
+  The compiler uses them when `a1` is dead after the operation. See `Lean.IR.ExplicitRC`. */
+
+static inline bool is_exclusive_mpz(b_obj_arg a1, b_obj_arg a2) {
+    return !lean_is_scalar(a1) && lean_is_exclusive(a1) && a1 != a2;
+}
+
+/* If the exclusive big number `a` fits in a scalar, deallocate `a` and return the scalar. */
+static obj_res nat_normalize_exclusive(obj_arg a) {
+    mpz const & v = mpz_value(a);
+    if (v.is_size_t() && v.get_size_t() <= LEAN_MAX_SMALL_NAT) {
+        size_t n = v.get_size_t();
+        lean_free_object(a);
+        return lean_box(n);
+    }
+    return a;
+}
+
+extern "C" LEAN_EXPORT object * lean_nat_big_add_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2))
+            v += static_cast<uint64>(lean_unbox(a2));
+        else
+            v += mpz_value(a2);
+        return a1;
+    }
+    object * r = lean_nat_big_add(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
+extern "C" LEAN_EXPORT object * lean_nat_big_sub_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2)) {
+            v -= static_cast<uint64>(lean_unbox(a2));
+        } else if (v < mpz_value(a2)) {
+            lean_free_object(a1);
+            return lean_box(0);
+        } else {
+            v -= mpz_value(a2);
+        }
+        return nat_normalize_exclusive(a1);
+    }
+    object * r = lean_nat_big_sub(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
+extern "C" LEAN_EXPORT object * lean_nat_big_mul_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2))
+            v *= static_cast<uint64>(lean_unbox(a2));
+        else
+            v *= mpz_value(a2);
+        return nat_normalize_exclusive(a1);
+    }
+    object * r = lean_nat_big_mul(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
 extern "C" LEAN_EXPORT object * lean_nat_overflow_mul(size_t a1, size_t a2) {
     return mpz_to_nat(mpz::of_size_t(a1) * mpz::of_size_t(a2));
 }
@@ -1371,9 +1890,14 @@ inline object * mpz_to_int_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
-static object * mpz_to_int(mpz const & m) {
+inline object * mpz_to_int_core(mpz && m) {
+    lean_assert(m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT);
+    return alloc_mpz(std::move(m));
+}
+
+static object * mpz_to_int(mpz && m) {
     if (m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT)
-        return mpz_to_int_core(m);
+        return mpz_to_int_core(std::move(m));
     else
         return lean_box(static_cast<unsigned>(m.get_int()));
 }
@@ -1382,7 +1906,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) {
     lean_assert(!lean_is_scalar(a));
     mpz m = mpz_value(a);
     lean_dec(a);
-    return mpz_to_nat(m);
+    return mpz_to_nat(std::move(m));
 }
 
 extern "C" LEAN_EXPORT object * lean_cstr_to_int(char const * n) {
@@ -1436,6 +1960,58 @@ extern "C" LEAN_EXPORT object * lean_int_big_mul(object * a1, object * a2) {
         return mpz_to_int(mpz_value(a1) * mpz_value(a2));
 }
 
+/* If the exclusive big number `a` fits in a scalar, deallocate `a` and return the scalar. */
+static obj_res int_normalize_exclusive(obj_arg a) {
+    mpz const & v = mpz_value(a);
+    if (v < LEAN_MIN_SMALL_INT || v > LEAN_MAX_SMALL_INT)
+        return a;
+    int n = v.get_int();
+    lean_free_object(a);
+    return lean_box(static_cast<unsigned>(n));
+}
+
+extern "C" LEAN_EXPORT object * lean_int_big_add_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2))
+            v += lean_scalar_to_int(a2);
+        else
+            v += mpz_value(a2);
+        return int_normalize_exclusive(a1);
+    }
+    object * r = lean_int_big_add(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
+extern "C" LEAN_EXPORT object * lean_int_big_sub_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2))
+            v -= lean_scalar_to_int(a2);
+        else
+            v -= mpz_value(a2);
+        return int_normalize_exclusive(a1);
+    }
+    object * r = lean_int_big_sub(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
+extern "C" LEAN_EXPORT object * lean_int_big_mul_in_place(object * a1, object * a2) {
+    if (is_exclusive_mpz(a1, a2)) {
+        mpz & v = to_mpz(a1)->m_value;
+        if (lean_is_scalar(a2))
+            v *= lean_scalar_to_int(a2);
+        else
+            v *= mpz_value(a2);
+        return int_normalize_exclusive(a1);
+    }
+    object * r = lean_int_big_mul(a1, a2);
+    lean_dec(a1);
+    return r;
+}
+
 extern "C" LEAN_EXPORT object * lean_int_big_div(object * a1, object * a2) {
     if (lean_is_scalar(a1)) {
         return mpz_to_int(lean_scalar_to_int(a1) / mpz_value(a2));
@@ -1732,7 +2308,19 @@ extern "C" LEAN_EXPORT object * lean_string_append(object * s1, object * s2) {
     size_t new_len  = len1 + len2;
     size_t new_sz   = sz1 + sz2 - 1;
     object * r;
+    if (sz2 == 1) {
+        // `s2` is the empty string
+        return s1;
+    }
     if (!lean_is_exclusive(s1)) {
+        if (sz1 == 1) {
+            /* `s1` is a shared empty string, so we would have to allocate a copy of `s2` anyway.
+               We share `s2` instead. Remark: we do not do it when `s1` is exclusive since it
+               may have been allocated with a capacity reserved for further appends. */
+            lean_inc_ref(s2);
+            lean_dec_ref(s1);
+            return s2;
+        }
         r = lean_alloc_string(new_sz, mk_capacity(new_sz), new_len);
         memcpy(w_string_cstr(r), lean_string_cstr(s1), sz1 - 1);
         dec_ref(s1);
@@ -2015,9 +2603,18 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b
     /* In the reference implementation if `e` is not pointing to a valid UTF8
        character start position, it is assumed to be at the end. */
     if (e < sz && !is_utf8_first_byte(str[e])) e = sz;
+    if (b == 0 && e == sz) {
+        // the result is the whole string
+        lean_inc_ref(s);
+        return s;
+    }
     usize new_sz = e - b;
     lean_assert(new_sz > 0);
-    return lean_mk_string_from_bytes_unchecked(lean_string_cstr(s) + b, new_sz);
+    if (lean_string_len(s) == sz) {
+        // `s` contains only ASCII characters, so we do not need to compute the length of the result
+        return lean_mk_string_unchecked(str + b, new_sz, new_sz);
+    }
+    return lean_mk_string_from_bytes_unchecked(str + b, new_sz);
 }
 
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0) {
@@ -2317,7 +2914,7 @@ extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2)
             if (!lean_string_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         } else {
-            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n1, 1)))
+            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         }
         n1 = lean_ctor_get(n1, 0);
@@ -2334,6 +2931,93 @@ extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2)
     }
 }
 
+#ifdef LEAN_INTERN_NAMES
+/*
+  Global table of interned names. It is partitioned by name hash, and each partition is protected by its own mutex.
+  It only contains names stored in compacted regions (i.e., the constant names of imported modules), which are persistent.
+  Names created at runtime are never added to the table, they are only replaced with an equal name from the table.
+*/
+#define LEAN_NAME_TABLE_SHARDS 64
+
+struct name_table_hash {
+    std::size_t operator()(object * n) const { return lean_name_hash_ptr(n); }
+};
+struct name_table_eq {
+    bool operator()(object * n1, object * n2) const { return lean_name_eq(n1, n2); }
+};
+struct name_table_shard {
+    mutex                                                        m_mutex;
+    std::unordered_set<object *, name_table_hash, name_table_eq> m_set;
+};
+static name_table_shard * g_name_table = nullptr;
+
+static name_table_shard & get_name_table_shard(b_obj_arg n) {
+    uint64 h = lean_name_hash_ptr(n);
+    return g_name_table[(h ^ (h >> 32)) % LEAN_NAME_TABLE_SHARDS];
+}
+
+extern "C" LEAN_EXPORT obj_res lean_name_intern(obj_arg n) {
+    if (lean_is_scalar(n))
+        return n;
+    name_table_shard & s = get_name_table_shard(n);
+    object * r;
+    {
+        unique_lock<mutex> lock(s.m_mutex);
+        auto it = s.m_set.find(n);
+        if (it == s.m_set.end() || *it == n)
+            return n;
+        r = *it;
+    }
+    // `r` is persistent
+    lean_dec(n);
+    return r;
+}
+
+extern "C" LEAN_EXPORT void lean_name_register(b_obj_arg n) {
+    if (lean_is_scalar(n))
+        return;
+    lean_assert(lean_is_persistent(n));
+    name_table_shard & s = get_name_table_shard(n);
+    unique_lock<mutex> lock(s.m_mutex);
+    s.m_set.insert(n);
+}
+
+static bool name_points_into(object * n, char const * begin, char const * end) {
+    while (!lean_is_scalar(n)) {
+        char const * p = reinterpret_cast<char const *>(n);
+        if (begin <= p && p < end)
+            return true;
+        n = lean_ctor_get(n, 0);
+    }
+    return false;
+}
+
+extern "C" LEAN_EXPORT void lean_name_forget_region(void const * begin, size_t size) {
+    char const * b = static_cast<char const *>(begin);
+    char const * e = b + size;
+    for (unsigned i = 0; i < LEAN_NAME_TABLE_SHARDS; i++) {
+        name_table_shard & s = g_name_table[i];
+        unique_lock<mutex> lock(s.m_mutex);
+        for (auto it = s.m_set.begin(); it != s.m_set.end();) {
+            if (name_points_into(*it, b, e))
+                it = s.m_set.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+#else
+extern "C" LEAN_EXPORT obj_res lean_name_intern(obj_arg n) {
+    return n;
+}
+
+extern "C" LEAN_EXPORT void lean_name_register(b_obj_arg) {
+}
+
+extern "C" LEAN_EXPORT void lean_name_forget_region(void const *, size_t) {
+}
+#endif
+
 // =======================================
 // Runtime info
 
@@ -2396,11 +3080,17 @@ void initialize_object() {
     g_ext_classes_mutex = new mutex();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
+#ifdef LEAN_INTERN_NAMES
+    g_name_table        = new name_table_shard[LEAN_NAME_TABLE_SHARDS];
+#endif
 }
 
 void finalize_object() {
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
+#ifdef LEAN_INTERN_NAMES
+    delete[] g_name_table;
+#endif
 }
 }
@@ -28,6 +28,7 @@ struct mpz_object {
     mpz         m_value;
     mpz_object() {}
     explicit mpz_object(mpz const & m):m_value(m) {}
+    explicit mpz_object(mpz && m):m_value(std::move(m)) {}
 };
 
 typedef lean_external_class         external_object_class;
@@ -46,6 +47,8 @@ inline bool is_mt_heap_obj(object * o) { return lean_is_mt(o); }
 inline bool is_st_heap_obj(object * o) { return lean_is_st(o); }
 inline bool is_heap_obj(object * o) { return is_st_heap_obj(o) || is_mt_heap_obj(o); }
 inline void mark_mt(object * o) { lean_mark_mt(o); }
+/* Apply the pending reference counter decrements of the current thread. No-op unless `LEAN_DEFERRED_MT_RC` is set. */
+LEAN_EXPORT void flush_deferred_rc();
 inline bool is_shared(object * o) { return lean_is_shared(o); }
 inline bool is_exclusive(object * o) { return lean_is_exclusive(o); }
 inline void inc_ref(object * o) { lean_inc_ref(o); }
@@ -178,6 +181,7 @@ inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply
 // MPZ
 
 LEAN_EXPORT object * alloc_mpz(mpz const &);
+LEAN_EXPORT object * alloc_mpz(mpz &&);
 inline mpz_object * to_mpz(object * o) { lean_assert(is_mpz(o)); return (mpz_object*)o; }
 
 // =======================================
@@ -218,6 +222,9 @@ inline void sarray_set_size(u_obj_arg o, size_t sz) { lean_sarray_set_size(o, sz
 inline unsigned sarray_elem_size(object * o) { return lean_sarray_elem_size(o); }
 inline size_t sarray_capacity(object * o) { return lean_sarray_capacity(o); }
 inline uint8 * sarray_cptr(object * o) { return lean_sarray_cptr(o); }
+/* Register `o`, a scalar array stored in the memory mapping `[base, base+size)`.
+   The mapping is released when `o` is deallocated. */
+void register_mapped_sarray(object * o, void * base, size_t size);
 
 // =======================================
 // ByteArray
@@ -310,6 +317,7 @@ inline obj_res mk_option_some(obj_arg v) { obj_res r = alloc_cnstr(1, 1, 0); cns
 
 inline mpz const & mpz_value(b_obj_arg o) { return to_mpz(o)->m_value; }
 LEAN_EXPORT object * mpz_to_nat_core(mpz const & m);
+LEAN_EXPORT object * mpz_to_nat_core(mpz && m);
 inline object * mk_nat_obj_core(mpz const & m) { return mpz_to_nat_core(m); }
 inline obj_res mk_nat_obj(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
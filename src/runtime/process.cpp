@@ -24,7 +24,13 @@ Author: Jared Roesch
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <spawn.h>
 #include <limits.h> // NOLINT
+#include <cstring>
+#include <vector>
+#ifdef __APPLE__
+#include <crt_externs.h>
+#endif
 #endif
 
 #include "runtime/object.h"
@@ -390,6 +396,175 @@ static optional<pipe> setup_stdio(stdio cfg) {
     lean_unreachable();
 }
 
+#ifdef __APPLE__
+// `environ` is not available to shared libraries on macOS
+static char ** get_environ() { return *_NSGetEnviron(); }
+#else
+extern "C" char ** environ;
+static char ** get_environ() { return environ; }
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define LEAN_POSIX_SPAWN_CHDIR
+#endif
+
+/*
+  Return true if `posix_spawn` supports the given spawn options.
+  Otherwise, we fall back to `fork` + `exec`.
+
+  Remark: `posix_spawnp` searches for the program using the `PATH` of the parent process,
+  while `execvp` in the forked child uses the updated environment. So we use `fork`
+  if `env` modifies `PATH`. */
+static bool can_use_posix_spawn(option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
+                                bool do_setsid) {
+#ifndef LEAN_POSIX_SPAWN_CHDIR
+    if (cwd) return false;
+#endif
+#ifndef POSIX_SPAWN_SETSID
+    if (do_setsid) return false;
+#endif
+    for (auto & entry : env) {
+        if (strcmp(entry.fst().data(), "PATH") == 0) return false;
+    }
+    return true;
+}
+
+/* Return the environment of the child process: the current one updated with `env`.
+   As with `setenv`/`unsetenv` in the `fork` path, the last entry for a variable wins.
+   The resulting strings are stored in `storage`. */
+static std::vector<char *> mk_child_environ(array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
+                                            std::vector<std::string> & storage) {
+    std::vector<char *> envp;
+    for (char ** e = get_environ(); *e != nullptr; e++) {
+        char const * eq = strchr(*e, '=');
+        size_t key_len  = eq ? eq - *e : strlen(*e);
+        bool overridden = false;
+        for (auto & entry : env) {
+            if (entry.fst().num_bytes() == key_len && strncmp(entry.fst().data(), *e, key_len) == 0) {
+                overridden = true;
+                break;
+            }
+        }
+        if (!overridden)
+            envp.push_back(*e);
+    }
+    for (size_t i = 0; i < env.size(); i++) {
+        auto & entry = env[i];
+        bool shadowed = false;
+        for (size_t j = i + 1; j < env.size(); j++) {
+            if (strcmp(env[j].fst().data(), entry.fst().data()) == 0) {
+                shadowed = true;
+                break;
+            }
+        }
+        if (!shadowed && entry.snd()) {
+            storage.push_back(entry.fst().to_std_string() + "=" + entry.snd().get()->to_std_string());
+        }
+    }
+    for (std::string & s : storage)
+        envp.push_back(const_cast<char *>(s.c_str()));
+    envp.push_back(nullptr);
+    return envp;
+}
+
+static void setup_spawn_stdio(posix_spawn_file_actions_t * actions, optional<pipe> const & p, stdio mode, int fd, bool in) {
+    int r = 0;
+    if (p) {
+        r = posix_spawn_file_actions_adddup2(actions, in ? p->m_read_fd : p->m_write_fd, fd);
+    } else if (mode == stdio::NUL) {
+        r = posix_spawn_file_actions_addopen(actions, fd, "/dev/null", in ? O_RDONLY : O_WRONLY, 0);
+    }
+    if (r != 0) throw r;
+}
+
+/*
+  Create the child process using `posix_spawnp`. On Linux, glibc implements it using
+  `clone(CLONE_VM | CLONE_VFORK)`, so we do not copy the page tables of the parent process.
+  This matters when the parent process has a big heap and many `.olean` files mapped in memory.
+  Remark: the pipe file descriptors are created with `O_CLOEXEC`, and `dup2` clears this flag. */
+static pid_t posix_spawn_child(string_ref const & proc_name, array_ref<string_ref> const & args,
+                               optional<pipe> const & stdin_pipe, optional<pipe> const & stdout_pipe, optional<pipe> const & stderr_pipe,
+                               stdio stdin_mode, stdio stdout_mode, stdio stderr_mode,
+                               option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
+                               bool do_setsid) {
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(proc_name.data()));
+    for (auto & arg : args)
+        argv.push_back(const_cast<char *>(arg.data()));
+    argv.push_back(nullptr);
+
+    std::vector<std::string> env_storage;
+    std::vector<char *> envp;
+    if (env.size() > 0)
+        envp = mk_child_environ(env, env_storage);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int r = posix_spawn_file_actions_init(&actions);
+    if (r != 0) throw r;
+    r = posix_spawnattr_init(&attr);
+    if (r != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        throw r;
+    }
+    try {
+        setup_spawn_stdio(&actions, stdin_pipe,  stdin_mode,  STDIN_FILENO,  true);
+        setup_spawn_stdio(&actions, stdout_pipe, stdout_mode, STDOUT_FILENO, false);
+        setup_spawn_stdio(&actions, stderr_pipe, stderr_mode, STDERR_FILENO, false);
+#ifdef LEAN_POSIX_SPAWN_CHDIR
+        if (cwd) {
+            r = posix_spawn_file_actions_addchdir_np(&actions, cwd.get()->data());
+            if (r != 0) throw r;
+        }
+#else
+        lean_assert(!cwd);
+#endif
+#ifdef POSIX_SPAWN_SETSID
+        if (do_setsid) {
+            r = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+            if (r != 0) throw r;
+        }
+#else
+        lean_assert(!do_setsid);
+#endif
+        pid_t pid;
+        r = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), env.size() > 0 ? envp.data() : get_environ());
+        if (r != 0) throw r;
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        return pid;
+    } catch (int) {
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        throw;
+    }
+}
+
+static void close_pipe(optional<pipe> const & p) {
+    if (p) {
+        close(p->m_read_fd);
+        close(p->m_write_fd);
+    }
+}
+
+/* Report `errno` to the parent through the close-on-exec pipe `fd`, and terminate the forked child. */
+[[noreturn]] static void report_child_error(int fd) {
+    int err = errno;
+    ssize_t r = write(fd, &err, sizeof(err));
+    (void)r;
+    _exit(127);
+}
+
+/* Return the error reported by `report_child_error`, or 0 if the child executed the program successfully. */
+static int read_child_error(int fd) {
+    int err = 0;
+    ssize_t r;
+    do {
+        r = read(fd, &err, sizeof(err));
+    } while (r == -1 && errno == EINTR);
+    return r == sizeof(err) ? err : 0;
+}
+
 static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
   stdio stderr_mode, option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
   bool do_setsid) {
@@ -398,7 +573,31 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
     auto stdout_pipe = setup_stdio(stdout_mode);
     auto stderr_pipe = setup_stdio(stderr_mode);
 
-    int pid = fork();
+    int pid;
+    /* In the `fork` path, errors in the child are sent back through this pipe, so that they are
+       reported as exceptions as in the `posix_spawn` path. The write end is closed by a successful `exec`. */
+    optional<pipe> err_pipe;
+    if (can_use_posix_spawn(cwd, env, do_setsid)) {
+        try {
+            pid = posix_spawn_child(proc_name, args, stdin_pipe, stdout_pipe, stderr_pipe,
+                                    stdin_mode, stdout_mode, stderr_mode, cwd, env, do_setsid);
+        } catch (int) {
+            close_pipe(stdin_pipe);
+            close_pipe(stdout_pipe);
+            close_pipe(stderr_pipe);
+            throw;
+        }
+    } else {
+        try {
+            err_pipe = setup_stdio(stdio::PIPED);
+        } catch (int) {
+            close_pipe(stdin_pipe);
+            close_pipe(stdout_pipe);
+            close_pipe(stderr_pipe);
+            throw;
+        }
+        pid = fork();
+    }
 
     if (pid == 0) {
         for (auto & entry : env) {
@@ -435,8 +634,7 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
 
         if (cwd) {
             if (chdir(cwd.get()->data()) < 0) {
-                std::cerr << "could not change directory to " << cwd.get()->data() << std::endl;
-                exit(-1);
+                report_child_error(err_pipe->m_write_fd);
             }
         }
 
@@ -450,12 +648,28 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
             pargs.push_back(strdup(arg.data()));
         pargs.push_back(NULL);
 
-        if (execvp(pargs[0], pargs.data()) < 0) {
-            std::cerr << "could not execute external process '" << pargs[0] << "'" << std::endl;
-            exit(-1);
-        }
+        execvp(pargs[0], pargs.data());
+        report_child_error(err_pipe->m_write_fd);
     } else if (pid == -1) {
-        throw errno;
+        int err = errno;
+        close_pipe(err_pipe);
+        close_pipe(stdin_pipe);
+        close_pipe(stdout_pipe);
+        close_pipe(stderr_pipe);
+        throw err;
+    }
+
+    if (err_pipe) {
+        close(err_pipe->m_write_fd);
+        int err = read_child_error(err_pipe->m_read_fd);
+        close(err_pipe->m_read_fd);
+        if (err != 0) {
+            waitpid(pid, nullptr, 0);
+            close_pipe(stdin_pipe);
+            close_pipe(stdout_pipe);
+            close_pipe(stderr_pipe);
+            throw err;
+        }
     }
 
     object * parent_stdin  = box(0);
@@ -518,7 +732,7 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_spawn(obj_arg args_, obj_arg) {
                 cnstr_get_ref_t<array_ref<pair_ref<string_ref, option_ref<string_ref>>>>(args, 4),
                 cnstr_get_uint8(args.raw(), 5 * sizeof(object *)));
     } catch (int err) {
-        return lean_io_result_mk_error(decode_io_error(err, nullptr));
+        return lean_io_result_mk_error(decode_io_error(err, cnstr_get(args.raw(), 1)));
     } catch (std::system_error const & err) {
         // TODO: decode
         return lean_io_result_mk_error(lean_mk_io_error_other_error(err.code().value(), mk_string(err.code().message())));
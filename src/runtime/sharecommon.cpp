@@ -5,8 +5,11 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <cstring>
+#include <deque>
+#include <memory>
 #include "runtime/sharecommon.h"
 #include "runtime/hash.h"
+#include "runtime/thread.h"
 
 namespace lean {
 
@@ -32,7 +35,7 @@ extern "C" LEAN_EXPORT uint64_t lean_sharecommon_hash(b_obj_arg o) {
     // hash relevant parts of the header
     unsigned init = hash(lean_ptr_tag(o), lean_ptr_other(o));
     // hash body
-    return hash_str(sz - header_sz, reinterpret_cast<unsigned char const *>(o) + header_sz, init);
+    return hash_bytes(sz - header_sz, reinterpret_cast<unsigned char const *>(o) + header_sz, init);
 }
 
 static obj_res mk_pair(obj_arg a, obj_arg b) {
@@ -43,6 +46,7 @@ static obj_res mk_pair(obj_arg a, obj_arg b) {
     return r;
 }
 
+/* State for `State.shareCommon`. The map and set are implemented in Lean, and accessed using the closures in the state factory `tc`. */
 class sharecommon_state {
 protected:
     object * m_map_find;
@@ -51,6 +55,16 @@ protected:
     object * m_set_insert;
     object * m_map;
     object * m_set;
+
+    /* Return the value stored in the `Option` object `o`, or `nullptr`.
+       The map and set keep a reference to the result. */
+    static b_obj_res get_opt(obj_arg o) {
+        if (o == lean_box(0))
+            return nullptr;
+        b_obj_res r = lean_ctor_get(o, 0);
+        lean_dec(o);
+        return r;
+    }
 public:
     sharecommon_state(b_obj_arg tc, obj_arg s) {
         m_map_find   = lean_ctor_get(tc, 1);
@@ -75,9 +89,9 @@ public:
         return r;
     }
 
-    obj_res map_find(b_obj_arg k) {
+    b_obj_res map_find(b_obj_arg k) {
         lean_inc(m_map_find); lean_inc(m_map); lean_inc(k);
-        return lean_apply_2(m_map_find, m_map, k);
+        return get_opt(lean_apply_2(m_map_find, m_map, k));
     }
 
     void map_insert(obj_arg k, obj_arg v) {
@@ -85,9 +99,9 @@ public:
         m_map = lean_apply_3(m_map_insert, m_map, k, v);
     }
 
-    obj_res set_find(b_obj_arg o) {
+    b_obj_res set_find(b_obj_arg o) {
         lean_inc(m_set_find); lean_inc(m_set); lean_inc(o);
-        return lean_apply_2(m_set_find, m_set, o);
+        return get_opt(lean_apply_2(m_set_find, m_set, o));
     }
 
     void set_insert(obj_arg o) {
@@ -96,8 +110,177 @@ public:
     }
 };
 
+/*
+Native state for `NativeState.shareCommon`, stored in an external object.
+`m_map` maps objects to their maximally shared representation using pointer equality, and
+`m_set` is the set of maximally shared objects (AKA hash-consing table).
+Both are open addressing hash tables using linear probing, and own a reference to their keys and values.
+*/
+class sharecommon_table {
+    struct map_entry {
+        lean_object * m_key   = nullptr;
+        lean_object * m_value = nullptr;
+    };
+    struct set_entry {
+        lean_object * m_obj  = nullptr;
+        uint64        m_hash = 0;
+    };
+    std::vector<map_entry> m_map;
+    size_t                 m_map_size = 0;
+    std::vector<set_entry> m_set;
+    size_t                 m_set_size = 0;
+
+    static constexpr size_t initial_capacity = 1024;
+
+    static uint64 ptr_hash(lean_object * o) {
+        return hash(reinterpret_cast<size_t>(o) >> 3, 11);
+    }
+
+    size_t map_slot(lean_object * k) const {
+        size_t mask = m_map.size() - 1;
+        size_t i    = ptr_hash(k) & mask;
+        while (m_map[i].m_key != nullptr && m_map[i].m_key != k)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    size_t set_slot(lean_object * o, uint64 h) const {
+        size_t mask = m_set.size() - 1;
+        size_t i    = h & mask;
+        while (m_set[i].m_obj != nullptr && (m_set[i].m_hash != h || !lean_sharecommon_eq(m_set[i].m_obj, o)))
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void grow_map() {
+        std::vector<map_entry> old;
+        old.swap(m_map);
+        m_map.resize(2 * old.size());
+        for (map_entry const & e : old) {
+            if (e.m_key != nullptr)
+                m_map[map_slot(e.m_key)] = e;
+        }
+    }
+
+    void grow_set() {
+        std::vector<set_entry> old;
+        old.swap(m_set);
+        m_set.resize(2 * old.size());
+        for (set_entry const & e : old) {
+            if (e.m_obj != nullptr)
+                m_set[set_slot(e.m_obj, e.m_hash)] = e;
+        }
+    }
+
+public:
+    sharecommon_table():m_map(initial_capacity), m_set(initial_capacity) {}
+
+    sharecommon_table(sharecommon_table const & other):
+        m_map(other.m_map), m_map_size(other.m_map_size), m_set(other.m_set), m_set_size(other.m_set_size) {
+        for_each([](lean_object * o) { lean_inc(o); });
+    }
+
+    ~sharecommon_table() {
+        for_each([](lean_object * o) { lean_dec(o); });
+    }
+
+    template<typename F> void for_each(F && f) const {
+        for (map_entry const & e : m_map) {
+            if (e.m_key != nullptr) { f(e.m_key); f(e.m_value); }
+        }
+        for (set_entry const & e : m_set) {
+            if (e.m_obj != nullptr) f(e.m_obj);
+        }
+    }
+
+    b_obj_res map_find(b_obj_arg k) const {
+        return m_map[map_slot(k)].m_value;
+    }
+
+    void map_insert(obj_arg k, obj_arg v) {
+        if (2 * (m_map_size + 1) > m_map.size())
+            grow_map();
+        map_entry & e = m_map[map_slot(k)];
+        if (e.m_key != nullptr) {
+            lean_dec(e.m_key);
+            lean_dec(e.m_value);
+        } else {
+            m_map_size++;
+        }
+        e.m_key   = k;
+        e.m_value = v;
+    }
+
+    b_obj_res set_find(b_obj_arg o) const {
+        return m_set[set_slot(o, lean_sharecommon_hash(o))].m_obj;
+    }
+
+    void set_insert(obj_arg o) {
+        if (2 * (m_set_size + 1) > m_set.size())
+            grow_set();
+        uint64 h = lean_sharecommon_hash(o);
+        set_entry & e = m_set[set_slot(o, h)];
+        if (e.m_obj != nullptr) {
+            lean_dec(e.m_obj);
+        } else {
+            m_set_size++;
+        }
+        e.m_obj  = o;
+        e.m_hash = h;
+    }
+};
+
+static lean_external_class * g_sharecommon_table_class = nullptr;
+
+static void sharecommon_table_finalizer(void * t) {
+    delete static_cast<sharecommon_table *>(t);
+}
+
+static void sharecommon_table_foreach(void * t, b_obj_arg fn) {
+    static_cast<sharecommon_table *>(t)->for_each([&](lean_object * o) {
+            lean_inc(fn); lean_inc(o);
+            lean_dec(lean_apply_1(fn, o));
+        });
+}
+
+static sharecommon_table * to_sharecommon_table(b_obj_arg s) {
+    return static_cast<sharecommon_table *>(lean_get_external_data(s));
+}
+
+/* State for `NativeState.shareCommon`. If the external object `s` is shared, we update a copy of its table. */
+class sharecommon_native_state {
+    object *            m_obj;
+    sharecommon_table * m_table;
+public:
+    sharecommon_native_state(obj_arg s) {
+        if (lean_is_exclusive(s)) {
+            m_obj = s;
+        } else {
+            m_obj = lean_alloc_external(g_sharecommon_table_class, new sharecommon_table(*to_sharecommon_table(s)));
+            lean_dec(s);
+        }
+        m_table = to_sharecommon_table(m_obj);
+    }
+
+    ~sharecommon_native_state() {
+        if (m_obj) lean_dec(m_obj);
+    }
+
+    obj_res pack(obj_arg a) {
+        obj_res r = mk_pair(a, m_obj);
+        m_obj = nullptr;
+        return r;
+    }
+
+    b_obj_res map_find(b_obj_arg k) { return m_table->map_find(k); }
+    void map_insert(obj_arg k, obj_arg v) { m_table->map_insert(k, v); }
+    b_obj_res set_find(b_obj_arg o) { return m_table->set_find(o); }
+    void set_insert(obj_arg o) { m_table->set_insert(o); }
+};
+
+template<typename State>
 class sharecommon_fn {
-    sharecommon_state         m_state;
+    State                     m_state;
     std::vector<lean_object*> m_children;
     std::vector<lean_object*> m_todo;
 
@@ -124,10 +307,8 @@ class sharecommon_fn {
         }
 
         // Check whether we have already maximized sharing for `a`
-        obj_res o = m_state.map_find(a);
-        if (o != lean_box(0)) {
-            obj_res r = lean_ctor_get(o, 0);
-            lean_dec(o);
+        b_obj_res r = m_state.map_find(a);
+        if (r != nullptr) {
             // The map still has a reference to `r`
             m_children.push_back(r);
             // std::cout << "cached maximized " << r << "\n";
@@ -142,12 +323,11 @@ class sharecommon_fn {
         lean_assert(m_todo.size() > 0);
         lean_assert(m_todo.back() == a);
         m_todo.pop_back();
-        obj_res opt_new_r = m_state.set_find(new_a);
-        if (opt_new_r != lean_box(0)) {
+        b_obj_res new_r = m_state.set_find(new_a);
+        if (new_r != nullptr) {
             lean_dec(new_a); // we already have a maximally shared term equivalent to `new_a`
-            new_a = lean_ctor_get(opt_new_r, 0);
+            new_a = new_r;
             lean_inc(new_a);
-            lean_dec(opt_new_r);
             lean_inc(a);
             m_state.map_insert(a, new_a);
             // std::cout << "already maximized " << new_a << "\n";
@@ -229,7 +409,8 @@ class sharecommon_fn {
     }
 
 public:
-    sharecommon_fn(b_obj_arg tc, obj_arg s):m_state(tc, s) {}
+    template<typename... Args>
+    sharecommon_fn(Args &&... args):m_state(std::forward<Args>(args)...) {}
 
     obj_res operator()(obj_arg a) {
         if (push_child(a)) {
@@ -253,11 +434,9 @@ public:
             }
         }
 
-        obj_res o = m_state.map_find(a);
-        lean_assert(o != lean_box(0));
-        obj_res r = lean_ctor_get(o, 0);
+        b_obj_res r = m_state.map_find(a);
+        lean_assert(r != nullptr);
         lean_inc(r);
-        lean_dec(o);
         lean_dec(a);
         return m_state.pack(r);
     }
@@ -265,9 +444,105 @@ public:
 
 // def State.shareCommon {α} {σ : @& StateFactory} (s : State σ) (a : α) : α × State σ
 extern "C" LEAN_EXPORT obj_res lean_state_sharecommon(b_obj_arg tc, obj_arg s, obj_arg a) {
-    return sharecommon_fn(tc, s)(a);
+    return sharecommon_fn<sharecommon_state>(tc, s)(a);
+}
+
+// opaque NativeState.mk : Unit → NativeState
+extern "C" LEAN_EXPORT obj_res lean_sharecommon_native_state_mk(obj_arg) {
+    return lean_alloc_external(g_sharecommon_table_class, new sharecommon_table());
 }
 
+// def NativeState.shareCommon (s : NativeState) (a : α) : α × NativeState
+extern "C" LEAN_EXPORT obj_res lean_native_state_sharecommon(obj_arg s, obj_arg a) {
+    return sharecommon_fn<sharecommon_native_state>(s)(a);
+}
+
+
+/*
+  Hash-consing table used by the workers of `sharecommon_par_fn`.
+  It is partitioned by object hash, and each partition is protected by its own mutex.
+*/
+#define LEAN_SHARECOMMON_NUM_SHARDS 64
+
+class sharecommon_shared_set {
+    struct entry {
+        lean_object * m_obj;
+        uint64_t      m_hash;
+    };
+    struct entry_hash {
+        std::size_t operator()(entry const & e) const { return e.m_hash; }
+    };
+    struct entry_eq {
+        bool operator()(entry const & e1, entry const & e2) const {
+            return e1.m_hash == e2.m_hash && lean_sharecommon_eq(e1.m_obj, e2.m_obj);
+        }
+    };
+    struct shard {
+        mutex                                            m_mutex;
+        std::unordered_set<entry, entry_hash, entry_eq> m_set;
+    };
+    shard m_shards[LEAN_SHARECOMMON_NUM_SHARDS];
+
+    shard & get_shard(uint64_t h) { return m_shards[(h ^ (h >> 32)) % LEAN_SHARECOMMON_NUM_SHARDS]; }
+public:
+    /* Return the object in the table that is equal to `o`, or `nullptr`. */
+    lean_object * find(lean_object * o) {
+        uint64_t h = lean_sharecommon_hash(o);
+        shard & s = get_shard(h);
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_set.find(entry{o, h});
+        return it == s.m_set.end() ? nullptr : it->m_obj;
+    }
+    /* Return the object in the table that is equal to `o`. If there is none, `o` is inserted and returned. */
+    lean_object * find_or_insert(lean_object * o) {
+        uint64_t h = lean_sharecommon_hash(o);
+        shard & s = get_shard(h);
+        lock_guard<mutex> lock(s.m_mutex);
+        return s.m_set.insert(entry{o, h}).first->m_obj;
+    }
+};
+
+/*
+  Objects in the range of the shared table and the terminal objects of the input may be reached by
+  different workers. Thus, their reference counters must be updated atomically, even if they are single threaded.
+*/
+static inline bool is_st_shared(lean_object * o) {
+    return lean_get_rc_mt_addr(o)->load(std::memory_order_relaxed) > 0;
+}
+
+static inline void inc_shared(lean_object * o) {
+    if (is_st_shared(o))
+        std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_relaxed);
+    else
+        lean_inc_ref(o);
+}
+
+static inline void dec_shared(lean_object * o) {
+    if (lean_is_scalar(o))
+        return;
+    if (is_st_shared(o))
+        std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_relaxed);
+    else
+        lean_dec_ref(o);
+}
+
+/*
+  Delete `o`, a new object equal to an object already in the shared table.
+  Its fields are also fields of the object in the table. So, the reference counters
+  of the fields do not reach zero, but other workers may be updating them concurrently.
+*/
+static void del_shared_duplicate(lean_object * o) {
+    if (lean_is_array(o)) {
+        size_t sz = lean_array_size(o);
+        for (size_t i = 0; i < sz; i++)
+            dec_shared(lean_array_get_core(o, i));
+    } else {
+        unsigned num_objs = lean_ctor_num_objs(o);
+        for (unsigned i = 0; i < num_objs; i++)
+            dec_shared(lean_ctor_get(o, i));
+    }
+    lean_free_object(o);
+}
 
 /*
   We do not increment reference counters when inserting Lean objects at `m_cache` and `m_set`.
@@ -280,6 +555,16 @@ extern "C" LEAN_EXPORT obj_res lean_state_sharecommon(b_obj_arg tc, obj_arg s, o
 */
 
 lean_object * sharecommon_quick_fn::check_cache(lean_object * a) {
+    if (m_shared) {
+        // `sharecommon_par_fn` stores the results of its workers in `m_cache` even if they are
+        // not shared, and the objects in the range of `m_cache` may be shared with other workers.
+        auto it = m_cache.find(a);
+        if (it != m_cache.end()) {
+            inc_shared(it->second);
+            return it->second;
+        }
+        return nullptr;
+    }
     if (!lean_is_exclusive(a)) {
         // We only check the cache if `a` is a shared object
         auto it = m_cache.find(a);
@@ -310,42 +595,55 @@ lean_object * sharecommon_quick_fn::check_cache(lean_object * a) {
 lean_object * sharecommon_quick_fn::save(lean_object * a, lean_object * new_a) {
     lean_assert(lean_is_st(new_a));
     lean_assert(new_a->m_rc == 1);
-    auto it = m_set.find(new_a);
     lean_object * result;
-    if (it == m_set.end()) {
-        // `new_a` is a new object
-        m_set.insert(new_a);
-        result = new_a;
+    if (m_shared) {
+        result = m_shared->find_or_insert(new_a);
+        if (result != new_a) {
+            del_shared_duplicate(new_a);
+            inc_shared(result);
+        }
     } else {
-        // We already have a maximally shared object that is equal to `new_a`
-        result = *it;
-        DEBUG_CODE({
-                if (lean_is_ctor(new_a)) {
-                    lean_assert(lean_is_ctor(result));
-                    unsigned num_objs = lean_ctor_num_objs(new_a);
-                    lean_assert(lean_ctor_num_objs(result) == num_objs);
-                    for (unsigned i = 0; i < num_objs; i++) {
-                        lean_assert(lean_ctor_get(result, i) == lean_ctor_get(new_a, i));
+        auto it = m_set.find(new_a);
+        if (it == m_set.end()) {
+            // `new_a` is a new object
+            m_set.insert(new_a);
+            result = new_a;
+        } else {
+            // We already have a maximally shared object that is equal to `new_a`
+            result = *it;
+            DEBUG_CODE({
+                    if (lean_is_ctor(new_a)) {
+                        lean_assert(lean_is_ctor(result));
+                        unsigned num_objs = lean_ctor_num_objs(new_a);
+                        lean_assert(lean_ctor_num_objs(result) == num_objs);
+                        for (unsigned i = 0; i < num_objs; i++) {
+                            lean_assert(lean_ctor_get(result, i) == lean_ctor_get(new_a, i));
+                        }
                     }
-                }
-            });
-        lean_dec_ref(new_a); // delete `new_a`
-        // All objects in `m_set` are single threaded.
-        lean_assert(lean_is_st(result));
-        result->m_rc++;
-        lean_assert(result->m_rc > 1);
+                });
+            lean_dec_ref(new_a); // delete `new_a`
+            // All objects in `m_set` are single threaded.
+            lean_assert(lean_is_st(result));
+            result->m_rc++;
+            lean_assert(result->m_rc > 1);
+        }
+        lean_assert(result == new_a || result->m_rc > 1);
+        lean_assert(result != new_a || result->m_rc == 1);
     }
     if (!lean_is_exclusive(a)) {
         // We only cache the result if `a` is a shared object.
         m_cache.insert(std::make_pair(a, result));
     }
-    lean_assert(result == new_a || result->m_rc > 1);
-    lean_assert(result != new_a || result->m_rc == 1);
     return result;
 }
 
 // `sarray` and `string`
 lean_object * sharecommon_quick_fn::visit_terminal(lean_object * a) {
+    if (m_shared) {
+        a = m_shared->find_or_insert(a);
+        inc_shared(a);
+        return a;
+    }
     auto it = m_set.find(a);
     if (it == m_set.end()) {
         m_set.insert(a);
@@ -358,7 +656,7 @@ lean_object * sharecommon_quick_fn::visit_terminal(lean_object * a) {
 
 lean_object * sharecommon_quick_fn::visit_array(lean_object * a) {
     lean_object * r = check_cache(a);
-    if (r != nullptr) { lean_assert(r->m_rc > 1); return r; }
+    if (r != nullptr) { lean_assert(m_shared || r->m_rc > 1); return r; }
 
     size_t sz = array_size(a);
     lean_array_object * new_a = (lean_array_object*)lean_alloc_array(sz, sz);
@@ -370,7 +668,7 @@ lean_object * sharecommon_quick_fn::visit_array(lean_object * a) {
 
 lean_object * sharecommon_quick_fn::visit_ctor(lean_object * a) {
     lean_object * r = check_cache(a);
-    if (r != nullptr) { lean_assert(r->m_rc > 1); return r; }
+    if (r != nullptr) { lean_assert(m_shared || r->m_rc > 1); return r; }
     unsigned num_objs      = lean_ctor_num_objs(a);
     unsigned tag           = lean_ptr_tag(a);
     unsigned sz            = lean_object_byte_size(a);
@@ -404,13 +702,10 @@ lean_object * sharecommon_quick_fn::visit(lean_object * a) {
       Similarly to `sharecommon_fn`, we only maximally share arrays, scalar arrays, strings, and
       constructor objects.
     */
-    case LeanMPZ:             lean_inc_ref(a); return a;
-    case LeanClosure:         lean_inc_ref(a); return a;
-    case LeanThunk:           lean_inc_ref(a); return a;
-    case LeanTask:            lean_inc_ref(a); return a;
-    case LeanRef:             lean_inc_ref(a); return a;
-    case LeanExternal:        lean_inc_ref(a); return a;
-    case LeanReserved:        lean_inc_ref(a); return a;
+    case LeanMPZ: case LeanClosure: case LeanThunk: case LeanTask:
+    case LeanRef: case LeanExternal: case LeanReserved:
+        if (m_shared) inc_shared(a); else lean_inc_ref(a);
+        return a;
     case LeanScalarArray:     return visit_terminal(a);
     case LeanString:          return visit_terminal(a);
     case LeanArray:           return visit_array(a);
@@ -418,11 +713,84 @@ lean_object * sharecommon_quick_fn::visit(lean_object * a) {
     }
 }
 
+/* Number of subgraphs per thread we try to collect before starting the workers. */
+#define LEAN_SHARECOMMON_PAR_SUBGRAPHS 32
+/* Maximum number of objects traversed sequentially while collecting the subgraphs. */
+#define LEAN_SHARECOMMON_PAR_MAX_TOP   65536
+
+lean_object * sharecommon_par_fn::operator()(lean_object * a) {
+    if (m_num_threads <= 1 || lean_is_scalar(a))
+        return sharecommon_quick_fn()(a);
+    /*
+      Breadth-first traversal of the top of the DAG. When it stops, `frontier` contains the roots of the subgraphs
+      that will be processed by the workers. If the whole DAG is traversed, it is too small to benefit from threads.
+    */
+    size_t target = static_cast<size_t>(m_num_threads) * LEAN_SHARECOMMON_PAR_SUBGRAPHS;
+    std::deque<lean_object *> frontier;
+    std::unordered_set<lean_object *> visited;
+    frontier.push_back(a);
+    visited.insert(a);
+    size_t num_top = 0;
+    while (!frontier.empty() && frontier.size() < target && num_top < LEAN_SHARECOMMON_PAR_MAX_TOP) {
+        lean_object * o = frontier.front();
+        frontier.pop_front();
+        num_top++;
+        auto push = [&](lean_object * c) {
+            if (!lean_is_scalar(c) && (lean_is_ctor(c) || lean_is_array(c)) && visited.insert(c).second)
+                frontier.push_back(c);
+        };
+        if (lean_is_array(o)) {
+            size_t sz = lean_array_size(o);
+            for (size_t i = 0; i < sz; i++)
+                push(lean_array_get_core(o, i));
+        } else if (lean_is_ctor(o)) {
+            unsigned num_objs = lean_ctor_num_objs(o);
+            for (unsigned i = 0; i < num_objs; i++)
+                push(lean_ctor_get(o, i));
+        }
+    }
+    if (frontier.size() < 2 * m_num_threads)
+        return sharecommon_quick_fn()(a);
+
+    sharecommon_shared_set set;
+    std::vector<lean_object *> roots(frontier.begin(), frontier.end());
+    std::vector<lean_object *> results(roots.size());
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        sharecommon_quick_fn fn(&set);
+        size_t i;
+        while ((i = next++) < roots.size())
+            results[i] = fn.visit(roots[i]);
+    };
+    unsigned num_workers = std::min(m_num_threads, static_cast<unsigned>(roots.size()));
+    std::vector<std::unique_ptr<lthread>> helpers;
+    for (unsigned i = 1; i < num_workers; i++)
+        helpers.emplace_back(new lthread(worker));
+    worker();
+    for (auto & h : helpers)
+        h->join();
+
+    // Rebuild the top of the DAG using the results of the workers.
+    sharecommon_quick_fn top(&set);
+    for (size_t i = 0; i < roots.size(); i++)
+        top.m_cache.insert(std::make_pair(roots[i], results[i]));
+    lean_object * r = top.visit(a);
+    // Release the references owned by `results`. All of them are now sub-objects of `r`.
+    for (lean_object * o : results)
+        lean_dec(o);
+    return r;
+}
+
 // def ShareCommon.shareCommon' (a : A) : A := a
 extern "C" LEAN_EXPORT obj_res lean_sharecommon_quick(obj_arg a) {
     return sharecommon_quick_fn()(a);
 }
 
+// def ShareCommon.shareCommonPar' (a : A) : A := a
+extern "C" LEAN_EXPORT obj_res lean_sharecommon_quick_par(obj_arg a) {
+    return sharecommon_par_fn(hardware_concurrency())(a);
+}
+
 lean_object * sharecommon_persistent_fn::operator()(lean_object * e) {
     lean_object * r = check_cache(e);
     if (r != nullptr)
@@ -432,4 +800,11 @@ lean_object * sharecommon_persistent_fn::operator()(lean_object * e) {
     m_saved.push_back(object_ref(r, true));
     return r;
 }
+
+void initialize_sharecommon() {
+    g_sharecommon_table_class = lean_register_external_class(sharecommon_table_finalizer, sharecommon_table_foreach);
+}
+
+void finalize_sharecommon() {
+}
 };
@@ -14,6 +14,8 @@ namespace lean {
 extern "C" LEAN_EXPORT uint8 lean_sharecommon_eq(b_obj_arg o1, b_obj_arg o2);
 extern "C" LEAN_EXPORT uint64_t lean_sharecommon_hash(b_obj_arg o);
 
+class sharecommon_shared_set;
+
 /*
 A faster version of `sharecommon_fn` which only uses a local state.
 It optimizes the number of RC operations, the strategy for caching results,
@@ -41,6 +43,11 @@ protected:
     been hashconsed.
     */
     bool m_check_set;
+    /*
+    If not `nullptr`, this object is one of the workers of a `sharecommon_par_fn`,
+    and `m_shared` is used instead of `m_set`.
+    */
+    sharecommon_shared_set * m_shared = nullptr;
 
     lean_object * check_cache(lean_object * a);
     lean_object * save(lean_object * a, lean_object * new_a);
@@ -48,6 +55,8 @@ protected:
     lean_object * visit_array(lean_object * a);
     lean_object * visit_ctor(lean_object * a);
     lean_object * visit(lean_object * a);
+    friend class sharecommon_par_fn;
+    sharecommon_quick_fn(sharecommon_shared_set * s):m_check_set(false), m_shared(s) {}
 public:
     sharecommon_quick_fn(bool s = false):m_check_set(s) {}
     void set_check_set(bool f) { m_check_set = f; }
@@ -68,4 +77,22 @@ public:
     lean_object * operator()(lean_object * e);
 };
 
+/*
+Parallel version of `sharecommon_quick_fn` for very large object graphs.
+The top of the input DAG is traversed sequentially until we have enough disjoint subgraphs,
+and these are maximally shared by `num_threads` workers using a hash-consing table partitioned
+by object hash. The result does not depend on the number of threads nor on scheduling:
+the maximally shared version of a DAG is unique up to the choice of representatives,
+and representatives of the same class are byte-wise equal.
+Small inputs are processed sequentially.
+*/
+class LEAN_EXPORT sharecommon_par_fn {
+    unsigned m_num_threads;
+public:
+    sharecommon_par_fn(unsigned num_threads):m_num_threads(num_threads) {}
+    lean_object * operator()(lean_object * a);
+};
+
+void initialize_sharecommon();
+void finalize_sharecommon();
 };
@@ -23,8 +23,18 @@ namespace lean {
 extern "C" obj_res lean_name_mk_string(obj_arg p, obj_arg s);
 extern "C" obj_res lean_name_mk_numeral(obj_arg p, obj_arg n);
 
+#ifdef LEAN_INTERN_NAMES
+/* Names created by the C++ code are replaced with equal constant names of imported modules if there are any,
+   see `lean_name_intern`. */
+static inline obj_res name_mk_string(obj_arg p, obj_arg s) { return lean_name_intern(lean_name_mk_string(p, s)); }
+static inline obj_res name_mk_numeral(obj_arg p, obj_arg n) { return lean_name_intern(lean_name_mk_numeral(p, n)); }
+#else
+static inline obj_res name_mk_string(obj_arg p, obj_arg s) { return lean_name_mk_string(p, s); }
+static inline obj_res name_mk_numeral(obj_arg p, obj_arg n) { return lean_name_mk_numeral(p, n); }
+#endif
+
 static inline obj_res name_mk_string_of_cstr(obj_arg p, char const * s) {
-    return lean_name_mk_string(p, mk_string(s));
+    return name_mk_string(p, mk_string(s));
 }
 
 constexpr char const * anonymous_str = "[anonymous]";
@@ -106,18 +116,18 @@ name::name(name const & prefix, char const * n):
 }
 
 name::name(name const & prefix, unsigned k):
-    object_ref(lean_name_mk_numeral(prefix.raw(), mk_nat_obj(k))) {
+    object_ref(name_mk_numeral(prefix.raw(), mk_nat_obj(k))) {
     inc(prefix.raw());
 }
 
 name::name(name const & prefix, string_ref const & s):
-    object_ref(lean_name_mk_string(prefix.raw(), s.raw())) {
+    object_ref(name_mk_string(prefix.raw(), s.raw())) {
     inc(prefix.raw());
     inc(s.raw());
 }
 
 name::name(name const & prefix, nat const & k):
-    object_ref(lean_name_mk_numeral(prefix.raw(), k.raw())) {
+    object_ref(name_mk_numeral(prefix.raw(), k.raw())) {
     inc(prefix.raw());
     inc(k.raw());
 }
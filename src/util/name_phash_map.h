@@ -0,0 +1,12 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+*/
+#pragma once
+#include "util/phash_map.h"
+#include "util/name.h"
+namespace lean {
+template<typename T> using name_phash_map = phash_map<name, T, name_hash_fn, name_eq_fn>;
+}
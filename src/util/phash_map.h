@@ -0,0 +1,280 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+*/
+#pragma once
+#include <utility>
+#include <vector>
+#include "runtime/debug.h"
+#include "util/rc.h"
+
+namespace lean {
+/**
+   \brief Persistent hash maps implemented using hash array mapped tries.
+
+   It uses a O(1) copy operation. Different maps can share nodes, and
+   the sharing is thread-safe. Nodes are only updated in place when they are not shared.
+   So, `phash_map` has the same persistent semantics of `rb_map`, but lookups only
+   compare hash codes until the key is found, instead of performing O(log n) key comparisons.
+   Use `rb_map` if the entries must be traversed in order.
+
+   \c HASH and \c EQ are functional objects for computing the hash code of a key (an `unsigned`),
+   and checking whether two keys are equal.
+*/
+template<typename K, typename T, typename HASH, typename EQ>
+class phash_map : private HASH, private EQ {
+    static constexpr unsigned num_bits  = 5;
+    static constexpr unsigned max_shift = sizeof(unsigned) * 8;
+
+    struct entry {
+        K        m_key;
+        T        m_value;
+        unsigned m_hash;
+        entry(K const & k, T const & v, unsigned h):m_key(k), m_value(v), m_hash(h) {}
+    };
+
+    struct node_cell;
+    struct node {
+        node_cell * m_ptr;
+        node():m_ptr(nullptr) {}
+        node(node_cell * ptr):m_ptr(ptr) { if (m_ptr) ptr->inc_ref(); }
+        node(node const & s):m_ptr(s.m_ptr) { if (m_ptr) m_ptr->inc_ref(); }
+        node(node && s):m_ptr(s.m_ptr) { s.m_ptr = nullptr; }
+        ~node() { if (m_ptr) m_ptr->dec_ref(); }
+        node & operator=(node const & n) { LEAN_COPY_REF(n); }
+        node & operator=(node&& n) { LEAN_MOVE_REF(n); }
+        operator bool() const { return m_ptr != nullptr; }
+        bool is_shared() const { return m_ptr && m_ptr->get_rc() > 1; }
+        node_cell * operator->() const { lean_assert(m_ptr); return m_ptr; }
+        friend bool is_eqp(node const & n1, node const & n2) { return n1.m_ptr == n2.m_ptr; }
+        friend void swap(node & n1, node & n2) { std::swap(n1.m_ptr, n2.m_ptr); }
+        node steal() { node r; swap(r, *this); return r; }
+    };
+
+    /*
+      Each node has `2^num_bits` slots. A slot is empty, contains an entry, or contains a child node.
+      `m_entries` (`m_children`) stores the entries (children) of the slots set in `m_entry_map` (`m_child_map`),
+      in slot order. When all bits of the hash codes have been used, we store the colliding entries
+      in `m_entries` of a node with both maps set to 0.
+    */
+    struct node_cell {
+        unsigned           m_entry_map;
+        unsigned           m_child_map;
+        std::vector<entry> m_entries;
+        std::vector<node>  m_children;
+        MK_LEAN_RC();
+        void dealloc() { delete this; }
+        node_cell():m_entry_map(0), m_child_map(0), m_rc(0) {}
+        node_cell(node_cell const & s):
+            m_entry_map(s.m_entry_map), m_child_map(s.m_child_map), m_entries(s.m_entries), m_children(s.m_children), m_rc(0) {}
+        bool is_empty() const { return m_entries.empty() && m_children.empty(); }
+    };
+
+    node     m_root;
+    unsigned m_size;
+
+    static unsigned slot_of(unsigned h, unsigned shift) { return (h >> shift) & ((1u << num_bits) - 1); }
+    static unsigned index_of(unsigned map, unsigned bit) { return __builtin_popcount(map & (bit - 1)); }
+
+    unsigned hash(K const & k) const { return HASH::operator()(k); }
+    bool eq(K const & k1, K const & k2) const { return EQ::operator()(k1, k2); }
+
+    static node ensure_unshared(node && n) {
+        if (n.is_shared()) {
+            return node(new node_cell(*n.m_ptr));
+        } else {
+            return std::move(n);
+        }
+    }
+
+    /* Return a node at depth `shift` containing `e1` and `e2`. Their keys must be different. */
+    static node mk_node(unsigned shift, entry const & e1, entry const & e2) {
+        node r(new node_cell());
+        if (shift >= max_shift) {
+            r->m_entries.push_back(e1);
+            r->m_entries.push_back(e2);
+            return r;
+        }
+        unsigned s1 = slot_of(e1.m_hash, shift);
+        unsigned s2 = slot_of(e2.m_hash, shift);
+        if (s1 == s2) {
+            r->m_child_map = 1u << s1;
+            r->m_children.push_back(mk_node(shift + num_bits, e1, e2));
+        } else {
+            r->m_entry_map = (1u << s1) | (1u << s2);
+            r->m_entries.push_back(s1 < s2 ? e1 : e2);
+            r->m_entries.push_back(s1 < s2 ? e2 : e1);
+        }
+        return r;
+    }
+
+    T const * find(node_cell const * n, unsigned shift, unsigned h, K const & k) const {
+        while (true) {
+            if (shift >= max_shift) {
+                for (entry const & e : n->m_entries) {
+                    if (eq(e.m_key, k))
+                        return &e.m_value;
+                }
+                return nullptr;
+            }
+            unsigned bit = 1u << slot_of(h, shift);
+            if (n->m_entry_map & bit) {
+                entry const & e = n->m_entries[index_of(n->m_entry_map, bit)];
+                return e.m_hash == h && eq(e.m_key, k) ? &e.m_value : nullptr;
+            } else if (n->m_child_map & bit) {
+                n = n->m_children[index_of(n->m_child_map, bit)].m_ptr;
+                shift += num_bits;
+            } else {
+                return nullptr;
+            }
+        }
+    }
+
+    node insert(node && n, unsigned shift, entry const & e) {
+        node h = n ? ensure_unshared(n.steal()) : node(new node_cell());
+        if (shift >= max_shift) {
+            for (entry & e_old : h->m_entries) {
+                if (eq(e_old.m_key, e.m_key)) {
+                    e_old.m_value = e.m_value;
+                    return h;
+                }
+            }
+            h->m_entries.push_back(e);
+            m_size++;
+            return h;
+        }
+        unsigned bit = 1u << slot_of(e.m_hash, shift);
+        if (h->m_entry_map & bit) {
+            unsigned i = index_of(h->m_entry_map, bit);
+            entry & e_old = h->m_entries[i];
+            if (e_old.m_hash == e.m_hash && eq(e_old.m_key, e.m_key)) {
+                e_old.m_value = e.m_value;
+                return h;
+            }
+            // replace the entry with a child node containing both entries
+            node c = mk_node(shift + num_bits, e_old, e);
+            m_size++;
+            h->m_entries.erase(h->m_entries.begin() + i);
+            h->m_entry_map &= ~bit;
+            h->m_children.insert(h->m_children.begin() + index_of(h->m_child_map, bit), c);
+            h->m_child_map |= bit;
+        } else if (h->m_child_map & bit) {
+            node & c = h->m_children[index_of(h->m_child_map, bit)];
+            c = insert(c.steal(), shift + num_bits, e);
+        } else {
+            h->m_entries.insert(h->m_entries.begin() + index_of(h->m_entry_map, bit), e);
+            h->m_entry_map |= bit;
+            m_size++;
+        }
+        return h;
+    }
+
+    /* Remove `k` from `n`. The result is null if it becomes empty. */
+    node erase(node && n, unsigned shift, unsigned h, K const & k) {
+        if (!find(n.m_ptr, shift, h, k))
+            return std::move(n);
+        node r = ensure_unshared(n.steal());
+        if (shift >= max_shift) {
+            for (unsigned i = 0; i < r->m_entries.size(); i++) {
+                if (eq(r->m_entries[i].m_key, k)) {
+                    r->m_entries.erase(r->m_entries.begin() + i);
+                    break;
+                }
+            }
+            m_size--;
+        } else {
+            unsigned bit = 1u << slot_of(h, shift);
+            if (r->m_entry_map & bit) {
+                r->m_entries.erase(r->m_entries.begin() + index_of(r->m_entry_map, bit));
+                r->m_entry_map &= ~bit;
+                m_size--;
+            } else {
+                lean_assert(r->m_child_map & bit);
+                unsigned i = index_of(r->m_child_map, bit);
+                node c = erase(r->m_children[i].steal(), shift + num_bits, h, k);
+                if (!c || (c->m_children.empty() && c->m_entries.size() == 1)) {
+                    // remove the child node, and move its remaining entry (if any) to this node
+                    r->m_children.erase(r->m_children.begin() + i);
+                    r->m_child_map &= ~bit;
+                    if (c) {
+                        r->m_entries.insert(r->m_entries.begin() + index_of(r->m_entry_map, bit), c->m_entries[0]);
+                        r->m_entry_map |= bit;
+                    }
+                } else {
+                    r->m_children[i] = c;
+                }
+            }
+        }
+        if (r->is_empty())
+            return node();
+        return r;
+    }
+
+    template<typename F>
+    static void for_each(F && f, node_cell const * n) {
+        if (n) {
+            for (entry const & e : n->m_entries)
+                f(e.m_key, e.m_value);
+            for (node const & c : n->m_children)
+                for_each(f, c.m_ptr);
+        }
+    }
+
+public:
+    phash_map(HASH const & h = HASH(), EQ const & e = EQ()):HASH(h), EQ(e), m_size(0) {}
+    phash_map(phash_map const & s):HASH(s), EQ(s), m_root(s.m_root), m_size(s.m_size) {}
+    phash_map(phash_map && s):HASH(s), EQ(s), m_root(s.m_root.steal()), m_size(s.m_size) { s.m_size = 0; }
+
+    phash_map & operator=(phash_map const & s) { m_root = s.m_root; m_size = s.m_size; return *this; }
+    phash_map & operator=(phash_map && s) {
+        if (this != &s) { m_root = s.m_root.steal(); m_size = s.m_size; s.m_size = 0; }
+        return *this;
+    }
+
+    friend void swap(phash_map & a, phash_map & b) { swap(a.m_root, b.m_root); std::swap(a.m_size, b.m_size); }
+    friend bool is_eqp(phash_map const & m1, phash_map const & m2) { return is_eqp(m1.m_root, m2.m_root); }
+    bool empty() const { return m_size == 0; }
+    void clear() { m_root = node(); m_size = 0; }
+    unsigned size() const { return m_size; }
+    unsigned get_rc() const { return m_root ? m_root->get_rc() : 0; }
+
+    void insert(K const & k, T const & v) {
+        m_root = insert(m_root.steal(), 0, entry(k, v, hash(k)));
+    }
+
+    T const * find(K const & k) const {
+        return m_root ? find(m_root.m_ptr, 0, hash(k), k) : nullptr;
+    }
+
+    bool contains(K const & k) const { return find(k) != nullptr; }
+
+    void erase(K const & k) {
+        if (m_root)
+            m_root = erase(m_root.steal(), 0, hash(k), k);
+    }
+
+    /** \brief Apply `f` to each key-value pair. The order is unspecified. */
+    template<typename F>
+    void for_each(F && f) const {
+        for_each(f, m_root.m_ptr);
+    }
+};
+template<typename K, typename T, typename HASH, typename EQ>
+phash_map<K, T, HASH, EQ> insert(phash_map<K, T, HASH, EQ> const & m, K const & k, T const & v) {
+    auto r = m;
+    r.insert(k, v);
+    return r;
+}
+template<typename K, typename T, typename HASH, typename EQ>
+phash_map<K, T, HASH, EQ> erase(phash_map<K, T, HASH, EQ> const & m, K const & k) {
+    auto r = m;
+    r.erase(k);
+    return r;
+}
+template<typename K, typename T, typename HASH, typename EQ, typename F>
+void for_each(phash_map<K, T, HASH, EQ> const & m, F && f) {
+    return m.for_each(f);
+}
+}
@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <fstream>
 #include <signal.h>
 #include <cctype>
+#include <cerrno>
 #include <cstdlib>
 #include <string>
 #include <utility>
@@ -175,6 +176,9 @@ extern "C" void *initialize_Lean_Compiler_IR_EmitLLVM(uint8_t builtin,
                                                       lean_object *);
 extern "C" object *lean_ir_emit_llvm(object *env, object *mod_name,
                                      object *filepath, object *w);
+extern "C" object *lean_ir_emit_llvm_partitioned(object *env, object *mod_name,
+                                                 object *filepath, uint32_t num_partitions,
+                                                 object *w);
 
 static void display_header(std::ostream & out) {
     out << "Lean (version " << get_version_string() << ", " << LEAN_STR(LEAN_BUILD_TYPE) << ")\n";
@@ -200,6 +204,8 @@ static void display_help(std::ostream & out) {
     std::cout << "  -i, --i=iname          create ilean file\n";
     std::cout << "  -c, --c=fname          name of the C output file\n";
     std::cout << "  -b, --bc=fname         name of the LLVM bitcode file\n";
+    std::cout << "      --llvm-partitions=num  split the LLVM output into num (at most 256) optimized object files\n"
+              << "                         fname.0.o ... generated in parallel, instead of the bitcode file\n";
     std::cout << "      --stdin            take input from stdin\n";
     std::cout << "      --root=dir         set package root directory from which the module name\n"
               << "                         of the input file is calculated\n"
@@ -254,6 +260,7 @@ static struct option g_long_options[] = {
     {"timeout",      optional_argument, 0, 'T'},
     {"c",            optional_argument, 0, 'c'},
     {"bc",           optional_argument, 0, 'b'},
+    {"llvm-partitions", required_argument, 0, 'L'},
     {"features",     optional_argument, 0, 'f'},
     {"exitOnPanic",  no_argument,       0, 'e'},
 #if defined(LEAN_MULTI_THREAD)
@@ -440,6 +447,21 @@ void check_optarg(char const * option_name) {
     }
 }
 
+/* Upper bound for `--llvm-partitions`, each partition is optimized by its own thread. */
+#define LEAN_MAX_LLVM_PARTITIONS 256
+
+static unsigned parse_llvm_partitions(char const * arg) {
+    char * end;
+    errno = 0;
+    long n = strtol(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || n < 1 || n > LEAN_MAX_LLVM_PARTITIONS) {
+        std::cerr << "error: invalid argument '" << arg << "' for option '--llvm-partitions', "
+                  << "it must be a number between 1 and " << LEAN_MAX_LLVM_PARTITIONS << std::endl;
+        std::exit(1);
+    }
+    return static_cast<unsigned>(n);
+}
+
 extern "C" object * lean_enable_initializer_execution(object * w);
 
 extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
@@ -497,6 +519,7 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     std::string native_output;
     optional<std::string> c_output;
     optional<std::string> llvm_output;
+    unsigned llvm_partitions = 0;
     optional<std::string> root_dir;
     buffer<string_ref> forwarded_args;
 
@@ -534,6 +557,10 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("bc");
                 llvm_output = optarg;
                 break;
+            case 'L':
+                check_optarg("llvm-partitions");
+                llvm_partitions = parse_llvm_partitions(optarg);
+                break;
             case 's':
                 lean::lthread::set_thread_stack_size(
                         static_cast<size_t>((atoi(optarg) / 4) * 4) * static_cast<size_t>(1024));
@@ -759,10 +786,17 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             initialize_Lean_Compiler_IR_EmitLLVM(/*builtin*/ false,
                     lean_io_mk_world());
             time_task _("LLVM code generation", opts);
-            lean::consume_io_result(lean_ir_emit_llvm(
-                        env.to_obj_arg(), (*main_module_name).to_obj_arg(),
-                        lean::string_ref(*llvm_output).to_obj_arg(),
-                        lean_io_mk_world()));
+            if (llvm_partitions > 0) {
+                lean::consume_io_result(lean_ir_emit_llvm_partitioned(
+                            env.to_obj_arg(), (*main_module_name).to_obj_arg(),
+                            lean::string_ref(*llvm_output).to_obj_arg(), llvm_partitions,
+                            lean_io_mk_world()));
+            } else {
+                lean::consume_io_result(lean_ir_emit_llvm(
+                            env.to_obj_arg(), (*main_module_name).to_obj_arg(),
+                            lean::string_ref(*llvm_output).to_obj_arg(),
+                            lean_io_mk_world()));
+            }
         }
 
         display_cumulative_profiling_times(std::cerr);
@@ -0,0 +1,34 @@
+/-!
+Closure application in a loop. The closure is still live after each application, so the
+compiler uses the borrowed `lean_apply_<n>_b` entry points and the closure's reference
+counter is not touched in the loop.
+-/
+
+def M := 1000003
+
+def iter1 (f : Nat → Nat) : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => iter1 f n (f acc)
+
+def iter2 (f : Nat → Nat → Nat) : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => iter2 f n (f acc n)
+
+def iter3 (f : Nat → Nat → Nat → Nat) : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => iter3 f n (f acc n 7)
+
+def iter4 (f : Nat → Nat → Nat → Nat → Nat) : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => iter4 f n (f acc n 7 11)
+
+def main : List String → IO Unit
+  | [n] => do
+    let n := n.toNat!
+    -- closures capturing `k` so that they are not lifted into constants
+    let k := n % 17
+    IO.println (iter1 (fun a => (a * 31 + k) % M) n 1)
+    IO.println (iter2 (fun a b => (a * 31 + b + k) % M) n 1)
+    IO.println (iter3 (fun a b c => (a * 31 + b * c + k) % M) n 1)
+    IO.println (iter4 (fun a b c d => (a * 31 + b * c + d + k) % M) n 1)
+  | _ => throw $ IO.userError "give number"
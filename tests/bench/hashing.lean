@@ -0,0 +1,32 @@
+/-!
+Hashes strings ranging from 8 B to 256 KB.
+`String.hash` uses the stable hash, while `ShareCommon.shareCommon'` hashes the same
+objects using the runtime's fast transient hash.
+The inputs are built once, so that the running time is dominated by hashing.
+-/
+
+def sizes : List Nat := [8, 64, 512, 4096, 32768, 262144]
+
+/-- Total number of bytes of the inputs of each size. -/
+def total : Nat := 1024 * 1024
+
+def mkInputs (size : Nat) : Array String := Id.run do
+  let base := String.mk (List.replicate (size - 1) 'a')
+  let mut r := #[]
+  for i in [0:max 1 (total / size)] do
+    r := r.push (base.push (Char.ofNat (97 + i % 8)))
+  return r
+
+def main : List String → IO Unit
+| [n] => do
+  let rounds := n.toNat!
+  let inputs := sizes.map fun size => (size, mkInputs size)
+  for (size, xs) in inputs do
+    let mut h : UInt64 := 7
+    for i in [0:rounds] do
+      h := xs.foldl (fun h s => mixHash h s.hash) (h + i.toUInt64)
+    let mut shared := 0
+    for _ in [0:rounds / 16 + 1] do
+      shared := shared + (ShareCommon.shareCommon' xs).size
+    IO.println s!"{size}: {shared} {h}"
+| _ => throw $ IO.userError "give number of rounds"
@@ -0,0 +1,25 @@
+/-!
+Line-oriented reading of a large file using `Handle.getLine` and `IO.FS.lines`.
+-/
+
+def fname : System.FilePath := "lines.tmp"
+
+partial def countLines (h : IO.FS.Handle) (n bytes : Nat) : IO (Nat × Nat) := do
+  let line ← h.getLine
+  if line.isEmpty then
+    return (n, bytes)
+  else
+    countLines h (n + 1) (bytes + line.utf8ByteSize)
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  IO.FS.withFile fname .write fun h => do
+    for i in [0:n] do
+      h.putStrLn s!"{i}: the quick brown fox jumps over the lazy dog λ {i * i}"
+  let (k, bytes) ← IO.FS.withFile fname .read fun h => countLines h 0 0
+  IO.println s!"{k} {bytes}"
+  let lines ← IO.FS.lines fname
+  IO.println s!"{lines.size} {lines.foldl (· + ·.length) 0}"
+  IO.FS.removeFile fname
+| _ => throw $ IO.userError "give number"
@@ -0,0 +1,38 @@
+/-!
+Several tasks traverse and rebuild a tree they all share. The tree is multi-threaded, so each
+`inc`/`dec` of its nodes is an atomic operation on a cache line shared by all workers.
+Used to evaluate the `DEFERRED_MT_RC` build option.
+-/
+
+inductive Tree where
+  | leaf (n : Nat)
+  | node (l r : Tree)
+
+def Tree.build : Nat → Nat → Tree
+  | 0,   i => .leaf i
+  | d+1, i => .node (build d (2*i)) (build d (2*i+1))
+
+def Tree.mirror : Tree → Tree
+  | .leaf n => .leaf n
+  | .node l r => .node r.mirror l.mirror
+
+def Tree.sum : Tree → Nat
+  | .leaf n => n
+  | .node l r => l.sum + r.sum
+
+def work (t : Tree) (rounds : Nat) : Nat := Id.run do
+  let mut s := 0
+  for _ in [0:rounds] do
+    s := s + t.mirror.sum
+  return s
+
+def main : List String → IO Unit
+  | [n] => do
+    let rounds := n.toNat!
+    let t := Tree.build 16 0
+    let tasks := (List.range 8).map fun _ => Task.spawn (prio := .dedicated) fun _ => work t rounds
+    let mut total := 0
+    for task in tasks do
+      total := total + task.get
+    IO.println total
+  | _ => throw $ IO.userError "give number"
@@ -0,0 +1,30 @@
+/-!
+Big `Nat`/`Int` accumulators. The accumulator is dead after each update, so the compiler
+uses `Nat.addInPlace` and friends, and the runtime updates the big number in place.
+-/
+
+def fib (n : Nat) : Nat := Id.run do
+  let mut a := 0
+  let mut b := 1
+  for _ in [0:n] do
+    (a, b) := (b, a + b)
+  return a
+
+/-- `∑ i < n, (-1)^i * 3^i` using a running power. -/
+def altPowSum (n : Nat) : Int := Id.run do
+  let mut s : Int := 0
+  let mut p : Int := 1
+  for _ in [0:n] do
+    s := s + p
+    p := p * (-3)
+  return s
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let f := fib n
+  IO.println (f % 1000000007)
+  IO.println f.log2
+  let s := altPowSum n
+  IO.println (s % 1000000007)
+| _ => throw $ IO.userError "give number"
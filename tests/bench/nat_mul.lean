@@ -0,0 +1,21 @@
+/-!
+Multiplication, division and printing of big `Nat`s. Run it with a GMP and a non-GMP
+build of Lean to compare both `mpz` implementations.
+-/
+
+/-- Product of `[lo, hi)`, computed using a balanced product tree. -/
+partial def prodRange (lo hi : Nat) : Nat :=
+  if hi - lo ≤ 8 then
+    (List.range' lo (hi - lo)).foldl (· * ·) 1
+  else
+    let mid := (lo + hi) / 2
+    prodRange lo mid * prodRange mid hi
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let f := prodRange 1 (n + 1)
+  IO.println (f % 1000000007)
+  IO.println (f / prodRange 1 (n / 2 + 1) % 1000000007)
+  IO.println f.log2
+| _ => throw $ IO.userError "give number"
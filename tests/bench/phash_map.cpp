@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+
+Microbenchmark comparing `rb_map` and `phash_map` (see `src/util/phash_map.h`).
+It uses string keys, which are hashed on every operation, unlike `name`s which cache their hash code.
+Build and run it against a release build, e.g.
+```
+c++ -O3 -DNDEBUG -std=c++14 -I../../src -I../../build/release/stage1/include phash_map.cpp -o phash_map && ./phash_map
+```
+*/
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "util/phash_map.h"
+#include "util/rb_map.h"
+
+using namespace lean; // NOLINT
+
+struct string_cmp { int operator()(std::string const & a, std::string const & b) const { return a.compare(b); } };
+struct string_hash { unsigned operator()(std::string const & s) const { return static_cast<unsigned>(std::hash<std::string>()(s)); } };
+struct string_eq { bool operator()(std::string const & a, std::string const & b) const { return a == b; } };
+
+template<typename F> static double time_ms(F && f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char ** argv) {
+    int n = argc > 1 ? std::stoi(argv[1]) : 200000;
+    std::vector<std::string> keys;
+    for (int i = 0; i < n; i++)
+        keys.push_back("Lean.Compiler.IR.EmitC.foo" + std::to_string(static_cast<long>(i) * 7919 % n));
+    rb_map<std::string, int, string_cmp> r;
+    phash_map<std::string, int, string_hash, string_eq> p;
+    long sum = 0;
+    std::printf("rb_map insert:    %.1f ms\n", time_ms([&]() { for (int i = 0; i < n; i++) r.insert(keys[i], i); }));
+    std::printf("phash_map insert: %.1f ms\n", time_ms([&]() { for (int i = 0; i < n; i++) p.insert(keys[i], i); }));
+    std::printf("rb_map find:      %.1f ms\n", time_ms([&]() { for (int k = 0; k < 5; k++) for (auto & key : keys) sum += *r.find(key); }));
+    std::printf("phash_map find:   %.1f ms\n", time_ms([&]() { for (int k = 0; k < 5; k++) for (auto & key : keys) sum += *p.find(key); }));
+    std::printf("rb_map erase:     %.1f ms\n", time_ms([&]() { for (auto & key : keys) r.erase(key); }));
+    std::printf("phash_map erase:  %.1f ms\n", time_ms([&]() { for (auto & key : keys) p.erase(key); }));
+    std::printf("checksum: %ld\n", sum + static_cast<long>(r.size()) + p.size());
+    return 0;
+}
@@ -0,0 +1,41 @@
+import Lean.Expr
+import Lean.Util.ShareCommon
+open Lean
+
+/-! Max sharing of large `Expr` DAGs using a state carried across calls. -/
+
+/-- A complete binary tree of applications whose leaves repeat with period 7.
+Structurally equal subterms are not physically shared. -/
+def mk : Nat → Nat → Expr
+  | 0,     i => mkNatLit (i % 7)
+  | d + 1, i => mkApp (mk d (2*i)) (mk d (2*i + 1))
+
+def sumLits : Expr → Nat
+  | .app f a            => sumLits f + sumLits a
+  | .lit (.natVal n)    => n
+  | _                   => 0
+
+def runNative (d : Nat) : Nat := Id.run do
+  let mut s : ShareCommon.NativeState := default
+  let mut total := 0
+  for i in [0:20] do
+    let (e, s') := s.shareCommon (mk d i)
+    s := s'
+    total := total + sumLits e
+  return total
+
+def runFactory (d : Nat) : Nat := Id.run do
+  let mut s : ShareCommon.State ShareCommon.objectFactory := default
+  let mut total := 0
+  for i in [0:20] do
+    let (e, s') := s.shareCommon (mk d i)
+    s := s'
+    total := total + sumLits e
+  return total
+
+/-- Usage: `sharecommon <depth> [native|factory]` -/
+def main (args : List String) : IO Unit := do
+  let d := args[0]!.toNat!
+  match args[1]? with
+  | some "factory" => IO.println (runFactory d)
+  | _              => IO.println (runNative d)
@@ -0,0 +1,17 @@
+/-!
+Spawn many short-lived processes from a parent process with a large heap.
+Creating the children using `fork` would copy the page tables of the whole heap each time.
+-/
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let heap := Array.range 20000000
+  let mut ok := 0
+  for _ in [0:n] do
+    let child ← IO.Process.spawn { cmd := "true" }
+    if (← child.wait) == 0 then
+      ok := ok + 1
+  IO.println ok
+  IO.println heap.back!
+| _ => throw $ IO.userError "give number"
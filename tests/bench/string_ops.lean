@@ -0,0 +1,33 @@
+/-!
+Append-heavy and substring-heavy `String` workloads.
+-/
+
+def build (n : Nat) (sep : String) : String := Id.run do
+  let mut s := ""
+  for i in [0:n] do
+    s := s ++ toString i ++ sep
+  return s
+
+/-- Appends to strings that are still referenced elsewhere. -/
+def buildShared (n : Nat) : Array String := Id.run do
+  let mut r := #[""]
+  for i in [0:n] do
+    r := r.push (r.back! ++ (if i % 64 == 0 then "" else "x"))
+  return r
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let s := build n " "
+  IO.println s.length
+  IO.println (build n "λ").length
+  IO.println (buildShared n).back!.length
+  let mut total := 0
+  for i in [0:n] do
+    total := total + (s.extract ⟨i⟩ ⟨i + 64⟩).length
+  IO.println total
+  let mut k := 0
+  for _ in [0:100] do
+    k := k + (s.extract 0 s.endPos).utf8ByteSize
+  IO.println k
+| _ => throw $ IO.userError "give number of appends"
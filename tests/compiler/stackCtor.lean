@@ -0,0 +1,15 @@
+structure Range' where
+  lo   : Nat
+  hi   : Nat
+  name : String
+
+-- `r` is borrowed and does not escape, so the callers allocate the `Range'` objects in their stack frame
+@[noinline] def Range'.width (r : Range') : Nat :=
+  r.hi - r.lo + r.name.length
+
+def sumWidths : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => sumWidths n (acc + (Range'.mk n (2*n+1) (toString n)).width)
+
+def main : IO Unit :=
+  IO.println (sumWidths 1000 0)
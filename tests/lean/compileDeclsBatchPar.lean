@@ -0,0 +1,22 @@
+import Lean
+open Lean Meta
+
+/-! `compileDeclsBatch` takes the parallel path for independent groups, also when its own trace is enabled. -/
+
+/-- `fun x => x + k` -/
+def mkAddFn (k : Nat) : Expr :=
+  .lam `x (mkConst ``Nat) (mkAppN (mkConst ``Nat.add) #[.bvar 0, mkNatLit k]) .default
+
+def addFn (n : Name) (value : Expr) : MetaM Unit :=
+  addDecl <| .defnDecl {
+    name := n, levelParams := [], type := ← mkArrow (mkConst ``Nat) (mkConst ``Nat)
+    value, hints := .abbrev, safety := .safe
+  }
+
+set_option trace.compiler.batch true in
+run_meta do
+  for i in [0:4] do
+    addFn (.mkSimple s!"parFn{i}") (mkAddFn i)
+  compileDeclsBatch ((List.range 4).map fun i => [.mkSimple s!"parFn{i}"])
+
+#eval parFn3 5
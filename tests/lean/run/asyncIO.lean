@@ -0,0 +1,44 @@
+def assertBEq [BEq α] [ToString α] (caption : String) (actual expected : α) : IO Unit := do
+  unless actual == expected do
+    throw <| IO.userError <|
+      s!"{caption}: expected '{expected}', got '{actual}'"
+
+def test : IO Unit := do
+  let timers ← (List.range 100).mapM fun i => IO.sleepAsync (i % 10).toUInt32
+  for t in timers do
+    IO.wait t
+  let fname : System.FilePath := "asyncIO.tmp"
+  let content := "hello async world".toUTF8
+  IO.ofExcept (← IO.wait (← IO.FS.writeBinFileAsync fname content))
+  let data ← IO.ofExcept (← IO.wait (← IO.FS.readBinFileAsync fname))
+  assertBEq "read" data.toList content.toList
+  IO.FS.removeFile fname
+  let r ← IO.wait (← IO.FS.readBinFileAsync fname)
+  assertBEq "missing" (r matches .error (.noFileOrDirectory ..)) true
+  let child ← IO.Process.spawn { cmd := "echo", args := #["piped"], stdout := .piped }
+  let out ← IO.ofExcept (← IO.wait (← child.stdout.readBinToEndAsync))
+  assertBEq "pipe" (String.fromUTF8! out) "piped\n"
+  assertBEq "exit" (← child.wait) 0
+  -- the output arrives after the read has started
+  let child ← IO.Process.spawn { cmd := "sh", args := #["-c", "sleep 0.1; echo late"], stdout := .piped }
+  let out ← IO.ofExcept (← IO.wait (← child.stdout.readBinToEndAsync))
+  assertBEq "late pipe" (String.fromUTF8! out) "late\n"
+  assertBEq "late exit" (← child.wait) 0
+  /- More pending pipe reads than threads in the `libuv` thread pool (4). The children only produce output after
+     the file operations below, which must not be queued behind the pipe reads. -/
+  let children ← (List.range 8).mapM fun _ =>
+    IO.Process.spawn { cmd := "sh", args := #["-c", "read x; echo $x"], stdin := .piped, stdout := .piped }
+  let outs ← children.mapM (·.stdout.readBinToEndAsync)
+  IO.ofExcept (← IO.wait (← IO.FS.writeBinFileAsync fname content))
+  let data ← IO.ofExcept (← IO.wait (← IO.FS.readBinFileAsync fname))
+  assertBEq "read while pipes are pending" data.toList content.toList
+  IO.FS.removeFile fname
+  for (child, i) in children.zip (List.range 8) do
+    let (stdin, child) ← child.takeStdin
+    stdin.putStrLn s!"child {i}"
+    stdin.flush
+    let out ← IO.ofExcept (← IO.wait outs[i]!)
+    assertBEq "slow pipe" (String.fromUTF8! out) s!"child {i}\n"
+    assertBEq "slow exit" (← child.wait) 0
+
+#eval test
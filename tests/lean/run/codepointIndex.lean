@@ -0,0 +1,61 @@
+import Lean.Data.Position
+import Lean.Data.Lsp.Utf16
+open Lean
+
+def refToPos (s : String) (n : Nat) : String.Pos :=
+  String.Iterator.nextn ⟨s, 0⟩ n |>.pos
+
+partial def refOfPos (s : String) (pos : String.Pos) : Nat :=
+  let rec go (i : String.Pos) (c : Nat) : Nat :=
+    if i == pos || s.atEnd i then c else go (s.next i) (c + 1)
+  go 0 0
+
+def checkIndex (s : String) : Bool := Id.run do
+  let idx := CodepointIndex.ofString s
+  for n in [0:s.length + 3] do
+    if idx.toPos n != refToPos s n then return false
+  for b in [0:s.utf8ByteSize + 3] do
+    if idx.ofPos ⟨b⟩ != refOfPos s ⟨b⟩ then return false
+  return true
+
+def mkLine (i : Nat) : String :=
+  s!"theorem t{i} : ∀ (α : Type), α → α := fun _ a => a -- 𝔽{i}\n"
+
+def big : String := String.join ((List.range 200).map mkLine)
+
+#guard checkIndex ""
+#guard checkIndex "abc"
+#guard checkIndex "λ x, x"
+#guard checkIndex (String.join ((List.range 200).map toString))
+#guard checkIndex big
+#guard (CodepointIndex.ofString big).samples.size > 1
+
+def fileMap := big.toFileMap
+
+#guard (List.range 200).all fun i =>
+  let pos := String.Iterator.nextn ⟨big, fileMap.lineStart (i + 1)⟩ 20 |>.pos
+  fileMap.toPosition pos == ⟨i + 1, 20⟩ && fileMap.ofPosition ⟨i + 1, 20⟩ == pos
+
+/-- Compares the line-relative conversions with the reference implementations in `String`. -/
+def checkColumns (s : String) : Bool := Id.run do
+  let idx := CodepointIndex.ofString s
+  let fmap := s.toFileMap
+  for h : i in [0:fmap.positions.size] do
+    let start := fmap.positions[i]
+    for col in [0:150] do
+      let pos := idx.advance start col
+      if pos != s.codepointPosToUtf8PosFrom start col then return false
+      let u := s.codepointPosToUtf16PosFrom col start
+      if idx.countFrom start pos != (col, u) then return false
+      if idx.advanceUtf16 start u != pos then return false
+  return true
+
+#guard checkColumns "λ x, x\n𝔽 y\n"
+#guard checkColumns big
+#guard checkColumns (String.join ((List.range 10).map fun i => String.mk (List.replicate (100 * i) '𝔽') ++ "\n"))
+
+#guard (List.range 200).all fun i =>
+  -- the end of line `i`, which contains a single character outside the BMP
+  let pos : String.Pos := ⟨(fileMap.lineStart (i + 2)).byteIdx - 1⟩
+  let lspPos : Lsp.Position := ⟨i, (mkLine i).length⟩
+  fileMap.lspPosToUtf8Pos lspPos == pos && fileMap.utf8PosToLspPos pos == lspPos
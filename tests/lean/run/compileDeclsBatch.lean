@@ -0,0 +1,33 @@
+import Lean
+open Lean Meta
+
+/-- `fun x => x + k` -/
+def mkAddFn (k : Nat) : Expr :=
+  .lam `x (mkConst ``Nat) (mkAppN (mkConst ``Nat.add) #[.bvar 0, mkNatLit k]) .default
+
+def addFn (n : Name) (value : Expr) : MetaM Unit :=
+  addDecl <| .defnDecl {
+    name := n, levelParams := [], type := ← mkArrow (mkConst ``Nat) (mkConst ``Nat)
+    value, hints := .abbrev, safety := .safe
+  }
+
+-- independent groups
+run_meta do
+  for i in [0:8] do
+    addFn (.mkSimple s!"batchFn{i}") (mkAddFn i)
+  compileDeclsBatch ((List.range 8).map fun i => [.mkSimple s!"batchFn{i}"])
+
+/-- info: 12 -/
+#guard_msgs in #eval batchFn7 5
+
+/-- info: 5 -/
+#guard_msgs in #eval batchFn0 5
+
+-- `batchDep1` uses `batchDep0`, so the groups are compiled sequentially
+run_meta do
+  addFn `batchDep0 (mkAddFn 100)
+  addFn `batchDep1 (.lam `x (mkConst ``Nat) (mkApp (mkConst `batchDep0) (.bvar 0)) .default)
+  compileDeclsBatch [[`batchDep0], [`batchDep1]]
+
+/-- info: 101 -/
+#guard_msgs in #eval batchDep1 1
@@ -0,0 +1,42 @@
+/-!
+Per-pass instrumentation of the compiler pipeline (`trace.compiler.stats` and `profiler`)
+must not affect the generated code.
+-/
+
+set_option trace.compiler.stats true in
+def sumSquares (xs : List Nat) : Nat :=
+  xs.foldl (fun acc x => acc + x * x) 0
+
+set_option profiler true in
+set_option profiler.threshold 0 in
+def countEven : List Nat → Nat
+  | [] => 0
+  | x :: xs => (if x % 2 == 0 then 1 else 0) + countEven xs
+
+/-- info: 14 -/
+#guard_msgs in
+#eval sumSquares [1, 2, 3]
+
+/-- info: 2 -/
+#guard_msgs in
+#eval countEven [1, 2, 3, 4]
+
+/-! The trace reports the LCNF size before and after each pass. -/
+
+open Lean Elab Command in
+run_cmd do
+  let input := "set_option trace.compiler.stats true in def statsFn (x : Nat) : Nat := x * x + 1"
+  let stx ← IO.ofExcept <| Parser.runParserCategory (← getEnv) `command input
+  let (out, _) ← IO.FS.withIsolatedStreams (elabCommand stx)
+  let lines := out.splitOn "\n" |>.filter (·.startsWith "[compiler.stats]")
+  for pass in ["cce", "simp", "specialize", "esimp", "simp_app_args"] do
+    unless lines.any (·.startsWith s!"[compiler.stats] {pass} statsFn: ") do
+      throwError "missing `{pass}` in:\n{out}"
+  for line in lines do
+    -- `[compiler.stats] <pass> statsFn: <before> -> <after>`
+    match line.splitOn ": " with
+    | [_, sizes] =>
+      match sizes.splitOn " -> " |>.map String.toNat? with
+      | [some _, some _] => pure ()
+      | _ => throwError "unexpected line: {line}"
+    | _ => throwError "unexpected line: {line}"
@@ -0,0 +1,16 @@
+def test : IO Unit := do
+  let fname : System.FilePath := "getLines.tmp"
+  IO.FS.writeFile fname "a\nbc\r\n\nλ\nlast"
+  IO.FS.withFile fname .read fun h => do
+    let batch ← h.getLines 3
+    unless batch == #["a\n", "bc\r\n", "\n"] do throw <| IO.userError s!"unexpected {batch}"
+    let batch ← h.getLines 10
+    unless batch == #["λ\n", "last"] do throw <| IO.userError s!"unexpected {batch}"
+    let batch ← h.getLines 10
+    unless batch.isEmpty do throw <| IO.userError s!"unexpected {batch}"
+    unless (← h.getLine).isEmpty do throw <| IO.userError "expected EOF"
+  let lines ← IO.FS.lines fname
+  unless lines == #["a", "bc", "", "λ", "last"] do throw <| IO.userError s!"unexpected {lines}"
+  IO.FS.removeFile fname
+
+#eval test
@@ -0,0 +1,152 @@
+import Lean.Compiler.IR
+open Lean IR
+
+/-!
+Escape analysis used by the C code generator to allocate constructor objects in the stack frame.
+-/
+
+def pairInfo : CtorInfo := { name := ``Prod.mk, cidx := 0, size := 2, usize := 0, ssize := 0 }
+
+def v (i : Nat) : VarId := ⟨i⟩
+
+def mkDecl (body : FnBody) : Decl :=
+  .fdecl `f #[{ x := v 1, borrow := false, ty := .object }] .object body {}
+
+def stackCtors (body : FnBody) (borrowsArg : FunId → Nat → Bool := fun _ _ => false) : List Nat :=
+  ((mkDecl body).stackCtors borrowsArg).toList.map (·.idx)
+
+/-- `let x_2 := ctor_0[Prod.mk] x_1 x_1; let x_3 := proj[0] x_2; inc x_3; dec x_2; ret x_3` -/
+def inspected : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .vdecl (v 3) .object (.proj 0 (v 2)) <|
+  .inc (v 3) 1 true false <|
+  .dec (v 2) 1 true false <|
+  .ret (.var (v 3))
+
+/-- info: [2] -/
+#guard_msgs in
+#eval stackCtors inspected
+
+/-- Returned constructor objects escape. -/
+def returned : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .ret (.var (v 2))
+
+/-- info: [] -/
+#guard_msgs in
+#eval stackCtors returned
+
+/-- Constructor objects passed to functions, or shared, escape. -/
+def passed : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .inc (v 2) 1 true false <|
+  .vdecl (v 3) .object (.fap `g #[.var (v 2)]) <|
+  .dec (v 2) 1 true false <|
+  .ret (.var (v 3))
+
+/-- info: [] -/
+#guard_msgs in
+#eval stackCtors passed
+
+/-- Constructor objects inspected by `case` do not escape. -/
+def cased : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .case ``Prod (v 2) .object #[.ctor pairInfo <|
+    .vdecl (v 3) .object (.proj 1 (v 2)) <|
+    .inc (v 3) 1 true false <|
+    .dec (v 2) 1 true false <|
+    .ret (.var (v 3))]
+
+/-- info: [2] -/
+#guard_msgs in
+#eval stackCtors cased
+
+/-- `dec x n` with `n > 1` means that `x` has other references. -/
+def decMany : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .vdecl (v 3) .object (.proj 0 (v 2)) <|
+  .inc (v 3) 1 true false <|
+  .dec (v 2) 2 true false <|
+  .ret (.var (v 3))
+
+/-- info: [] -/
+#guard_msgs in
+#eval stackCtors decMany
+
+/-- Constructor objects passed to a borrowed parameter that does not escape the callee do not escape. -/
+def borrowed : FnBody :=
+  .inc (v 1) 1 true false <|
+  .vdecl (v 2) .object (.ctor pairInfo #[.var (v 1), .var (v 1)]) <|
+  .vdecl (v 3) .object (.fap `g #[.var (v 2)]) <|
+  .dec (v 2) 1 true false <|
+  .ret (.var (v 3))
+
+/-- info: [2] -/
+#guard_msgs in
+#eval stackCtors borrowed (fun f i => f == `g && i == 0)
+
+/-- info: [] -/
+#guard_msgs in
+#eval stackCtors borrowed
+
+def mkBorrowingDecl (body : FnBody) : Decl :=
+  .fdecl `g #[{ x := v 1, borrow := true, ty := .object }, { x := v 2, borrow := false, ty := .object }] .object body {}
+
+/-- Borrowed parameters that are only inspected, or passed back to the same borrowed parameter, do not escape. -/
+def projects : FnBody :=
+  .vdecl (v 3) .object (.proj 0 (v 1)) <|
+  .inc (v 3) 1 true false <|
+  .vdecl (v 4) .object (.fap `g #[.var (v 1), .var (v 3)]) <|
+  .ret (.var (v 4))
+
+#guard (mkBorrowingDecl projects).nonEscapingParams == #[0]
+
+/-- Borrowed parameters that are returned, or passed to other functions, escape. -/
+def returnsParam : FnBody :=
+  .inc (v 1) 1 true false <|
+  .ret (.var (v 1))
+
+def passesParam : FnBody :=
+  .vdecl (v 3) .object (.fap `h #[.var (v 1)]) <|
+  .ret (.var (v 3))
+
+#guard (mkBorrowingDecl returnsParam).nonEscapingParams == #[]
+#guard (mkBorrowingDecl passesParam).nonEscapingParams == #[]
+
+def consInfo : CtorInfo := { name := ``List.cons, cidx := 1, size := 2, usize := 0, ssize := 0 }
+
+def mkSwappingDecl (body : FnBody) : Decl :=
+  .fdecl `g #[{ x := v 1, borrow := true, ty := .object }, { x := v 2, borrow := true, ty := .object },
+    { x := v 3, borrow := false, ty := .tobject }] .object body {}
+
+/--
+`g p q n := if n = 0 then [q] else g q p (n-1)`: `q` escapes, and `p` flows into the parameter `q` in the
+recursive call, so it escapes too.
+-/
+def swapsEscaping : FnBody :=
+  .case ``Nat (v 3) .tobject #[
+    .ctor { name := ``Nat.zero, cidx := 0, size := 0, usize := 0, ssize := 0 } <|
+      .inc (v 2) 1 true false <|
+      .vdecl (v 4) .object (.ctor consInfo #[.var (v 2), .irrelevant]) <|
+      .ret (.var (v 4)),
+    .default <|
+      .vdecl (v 4) .object (.fap `g #[.var (v 2), .var (v 1), .var (v 3)]) <|
+      .ret (.var (v 4))]
+
+#guard (mkSwappingDecl swapsEscaping).nonEscapingParams == #[]
+
+/-- `g p q n := if n = 0 then n else g q p (n-1)`: neither parameter escapes. -/
+def swaps : FnBody :=
+  .case ``Nat (v 3) .tobject #[
+    .ctor { name := ``Nat.zero, cidx := 0, size := 0, usize := 0, ssize := 0 } <|
+      .ret (.var (v 3)),
+    .default <|
+      .vdecl (v 4) .object (.fap `g #[.var (v 2), .var (v 1), .var (v 3)]) <|
+      .ret (.var (v 4))]
+
+#guard (mkSwappingDecl swaps).nonEscapingParams == #[0, 1]
@@ -0,0 +1,38 @@
+import Lean
+open Lean
+
+/-!
+The C code generator allocates constructor objects that do not escape in the stack frame,
+see also `tests/compiler/stackCtor.lean`.
+-/
+
+structure Range' where
+  lo   : Nat
+  hi   : Nat
+  name : String
+
+@[noinline] def Range'.width (r : Range') : Nat :=
+  r.hi - r.lo + r.name.length
+
+def sumWidths : Nat → Nat → Nat
+  | 0,   acc => acc
+  | n+1, acc => sumWidths n (acc + (Range'.mk n (2*n+1) (toString n)).width)
+
+def emittedC : CoreM String := do
+  match IR.emitC (← getEnv) (← getMainModule) with
+  | .ok c      => return c
+  | .error err => throwError err
+
+def contains (s t : String) : Bool :=
+  (s.splitOn t).length > 1
+
+/-- info: #[0] -/
+#guard_msgs in
+#eval show CoreM _ from do
+  return (IR.findEnvDecl (← getEnv) ``Range'.width).get!.nonEscapingParams
+
+/-- info: (true, true) -/
+#guard_msgs in
+#eval show CoreM _ from do
+  let c ← emittedC
+  return (contains c "LEAN_STACK_CTOR(", contains c "lean_dec_stack_ctor(")
@@ -0,0 +1,50 @@
+import Lean
+open Lean
+
+/-!
+The kernel looks up imported constants using the index built at import time,
+and local declarations using the `ConstMap`.
+-/
+
+def myTwo : Nat := Nat.succ (Nat.succ Nat.zero)
+
+theorem myTwo_eq : myTwo = 2 := rfl
+
+theorem imported_eq : Nat.add 1 1 = 2 := rfl
+
+def myFour : Nat := myTwo + myTwo
+
+theorem myFour_eq : myFour = List.length [1, 2, 3, 4] := by decide
+
+/-- Every imported constant is in the index, and local declarations are not. -/
+#eval show CoreM Unit from do
+  let env ← getEnv
+  let idx := env.header.constIndex
+  for (declName, info) in env.constants.map₁.toList do
+    let some info' := idx.find? declName | throwError "'{declName}' is not in the index"
+    unless info'.name == declName && info'.type == info.type do
+      throwError "wrong constant for '{declName}'"
+  for declName in [``myTwo, ``myTwo_eq, ``myFour] do
+    unless env.contains declName && (idx.find? declName).isNone do
+      throwError "local declaration '{declName}' is in the index"
+
+def mkModule (constNames : Array Name) (constants : Array ConstantInfo) : ModuleData :=
+  { imports := #[], constNames, constants, extraConstNames := #[], entries := #[] }
+
+-- numerals of 2^64 and above have the same hash code
+def c₁ : Name := .num `c (2^64)
+def c₂ : Name := .num `c (2^64 + 1)
+#guard hash c₁ == hash c₂
+
+/--
+Duplicate names are ignored, the first occurrence is used, even if a different name with the same hash code is between
+them after sorting. Different names with the same hash code are all found.
+-/
+#eval show CoreM Unit from do
+  let info (n : Name) : CoreM ConstantInfo := getConstInfo n
+  let m₁ := mkModule #[`a, c₁] #[← info ``Nat.add, ← info ``Nat.mul]
+  let m₂ := mkModule #[c₂, c₁, `a] #[← info ``Nat.sub, ← info ``Nat.div, ← info ``Nat.mod]
+  let idx := mkImportedConstIndex #[m₁, m₂]
+  let found := [`a, c₁, c₂, `b].map fun n => (idx.find? n).map (·.name)
+  unless found == [some ``Nat.add, some ``Nat.mul, some ``Nat.sub, none] do
+    throwError "unexpected result {found}"
@@ -0,0 +1,26 @@
+def assertBEq [BEq α] [ToString α] (caption : String) (actual expected : α) : IO Unit := do
+  unless actual == expected do
+    throw <| IO.userError <|
+      s!"{caption}: expected '{expected}', got '{actual}'"
+
+inductive Tree where
+  | leaf (n : Nat)
+  | node (l r : Tree)
+
+def Tree.build : Nat → Nat → Tree
+  | 0,   i => .leaf i
+  | d+1, i => .node (build d (2*i)) (build d (2*i+1))
+
+def Tree.sum : Tree → Nat
+  | .leaf n => n
+  | .node l r => l.sum + r.sum
+
+/-- Task results are marked as multi-threaded. Big results are marked by several threads. -/
+def test : IO Unit := do
+  let tasks := (List.range 4).map fun k => Task.spawn fun _ => (Tree.build 18 k, k)
+  for t in tasks do
+    let (tree, k) := t.get
+    -- leaves are `k * 2^18 + j` for `j < 2^18`
+    assertBEq "sum" tree.sum (k * 2^18 * 2^18 + 2^18 * (2^18 - 1) / 2)
+
+#eval test
@@ -0,0 +1,47 @@
+def assertBEq [BEq α] [ToString α] (caption : String) (actual expected : α) : IO Unit := do
+  unless actual == expected do
+    throw <| IO.userError <|
+      s!"{caption}: expected '{expected}', got '{actual}'"
+
+def fname : System.FilePath := "mmapBinFile.tmp"
+def content : ByteArray := ByteArray.mk <| (Array.range 10000).map (·.toUInt8)
+
+/-- The array outlives the function that mapped the file. -/
+def mapped : IO ByteArray :=
+  IO.FS.mmapBinFile fname
+
+def test : IO Unit := do
+  IO.FS.writeBinFile fname content
+  let bs ← mapped
+  assertBEq "size" bs.size content.size
+  assertBEq "contents" bs.toList content.toList
+  -- updating a shared mapped array copies it
+  let bs' := bs.set! 0 42
+  assertBEq "updated" bs'[0]! 42
+  assertBEq "original" bs[0]! 0
+  assertBEq "copy" (bs.extract 1 5).toList [1, 2, 3, 4]
+  -- updating an exclusive mapped array does not modify the file
+  let bs'' := (← mapped).set! 1 42 |>.push 7
+  assertBEq "exclusive" (bs''.extract 0 3).toList [0, 42, 2]
+  assertBEq "pushed" bs''.size (content.size + 1)
+  assertBEq "file" (← IO.FS.readBinFile fname).toList content.toList
+  -- mapped arrays shared by tasks
+  let tasks := (List.range 8).map fun i => Task.spawn fun _ => bs[i]!.toNat
+  assertBEq "shared" (tasks.map Task.get) (List.range 8)
+  -- the mappings are released when the arrays are freed
+  let mut total := 0
+  for _ in [0:1000] do
+    total := total + (← mapped).size
+  assertBEq "released" total (1000 * content.size)
+  assertBEq "still mapped" bs.toList content.toList
+  IO.FS.writeBinFile fname .empty
+  assertBEq "empty" (← mapped).size 0
+  IO.FS.removeFile fname
+  try
+    discard <| mapped
+    throw <| IO.userError "missing file was mapped"
+  catch
+    | .noFileOrDirectory .. => pure ()
+    | e => throw e
+
+#eval test
@@ -0,0 +1,20 @@
+/-!
+Numeric components that do not fit in `UInt64` all have the same hash code,
+so `Name.beq` must compare them.
+-/
+
+open Lean
+
+def big : Nat := 2^64
+
+/-- info: false -/
+#guard_msgs in
+#eval Name.num `a big == Name.num `a (big + 1)
+
+/-- info: true -/
+#guard_msgs in
+#eval Name.num `a big == Name.num `a (2^64)
+
+/-- info: false -/
+#guard_msgs in
+#eval Name.num (Name.num `a big) 1 == Name.num (Name.num `a (big + 1)) 1
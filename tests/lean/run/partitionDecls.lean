@@ -0,0 +1,38 @@
+import Lean.Compiler.IR.EmitLLVM
+open Lean IR EmitLLVM
+
+/-!
+Partitioning of the declarations of a module for `--llvm-partitions`.
+-/
+
+def v (i : Nat) : VarId := ⟨i⟩
+
+/-- A declaration whose body consists of `w` instructions. -/
+def mkDecl (n : Name) (w : Nat) : Decl :=
+  let body := (List.range (w - 1)).foldl (fun b _ => .inc (v 1) 1 true false b) (.ret (.var (v 1)))
+  .fdecl n #[{ x := v 1, borrow := false, ty := .object }] .object body {}
+
+def decls : List Decl :=
+  [mkDecl `a 6, mkDecl `b 5, mkDecl `c 3, mkDecl `d 2, mkDecl `e 1,
+   .extern `x #[] .object { entries := [] }]
+
+def sorted (s : NameSet) : List String :=
+  (s.toList.map toString).toArray.qsort (· < ·) |>.toList
+
+#guard declWeight (mkDecl `a 6) == 6
+#guard declWeight (decls.getLast!) == 0
+
+-- heaviest first, each declaration goes to the lightest partition
+#guard (partitionDecls decls 2).map sorted == #[["a", "d", "e"], ["b", "c", "x"]]
+
+-- every declaration lands in exactly one partition
+#guard (partitionDecls decls 3).foldl (· + ·.toList.length) 0 == decls.length
+#guard decls.all fun d => ((partitionDecls decls 3).filter (·.contains d.name)).size == 1
+
+-- `n = 0` is treated as a single partition
+#guard (partitionDecls decls 0).size == 1
+#guard sorted (partitionDecls decls 0)[0]! == ["a", "b", "c", "d", "e", "x"]
+
+-- more partitions than declarations leaves some of them empty
+#guard (partitionDecls decls 8).size == 8
+#guard ((partitionDecls decls 8).filter (·.isEmpty)).size == 2
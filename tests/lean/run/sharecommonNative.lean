@@ -0,0 +1,66 @@
+import Lean.Util.ShareCommon
+
+open Lean.ShareCommon
+def check (b : Bool) : NShareCommonT IO Unit := do
+  unless b do throw $ IO.userError "check failed"
+
+@[noinline] def mkList1 (x : Nat) : List Nat := List.replicate x x
+@[noinline] def mkList2 (x : Nat) : List Nat := List.replicate x x
+@[noinline] def mkArray1 (x : Nat) : Array (List Nat) :=
+#[ mkList1 x, mkList2 x, mkList2 (x+1) ]
+@[noinline] def mkArray2 (x : Nat) : Array (List Nat) :=
+mkArray1 x
+
+unsafe def tst1 : NShareCommonT IO Unit := do
+let a := mkArray1 3
+let b := mkArray2 3
+let c := mkArray2 4
+check $
+  ptrAddrUnsafe a != ptrAddrUnsafe b &&
+  ptrAddrUnsafe a[0]! != ptrAddrUnsafe a[1]!
+let a ← shareCommonM a
+let b ← shareCommonM b
+let c ← shareCommonM c
+check $
+  ptrAddrUnsafe a == ptrAddrUnsafe b &&
+  ptrAddrUnsafe a != ptrAddrUnsafe c &&
+  ptrAddrUnsafe a[0]! == ptrAddrUnsafe a[1]! &&
+  ptrAddrUnsafe a[0]! != ptrAddrUnsafe a[2]! &&
+  ptrAddrUnsafe a[2]! == ptrAddrUnsafe c[0]!
+IO.println a
+IO.println c
+
+/--
+info: #[[3, 3, 3], [3, 3, 3], [4, 4, 4, 4]]
+#[[4, 4, 4, 4], [4, 4, 4, 4], [5, 5, 5, 5, 5]]
+-/
+#guard_msgs in
+#eval tst1.run
+
+/-- Many distinct objects, to exercise table growth. -/
+unsafe def tst2 : NShareCommonT IO Unit := do
+let mut xs := #[]
+for i in [0:5000] do
+  xs := xs.push (← shareCommonM [i, i+1])
+for i in [0:5000] do
+  let x ← shareCommonM (List.range 2 |>.map (· + i))
+  check $ ptrAddrUnsafe x == ptrAddrUnsafe xs[i]!
+IO.println xs.size
+
+/-- info: 5000 -/
+#guard_msgs in
+#eval tst2.run
+
+/-- A shared state is copied, and both copies remain usable. -/
+unsafe def tst3 : IO Unit := do
+let s : ShareCommon.NativeState := default
+let (x, s) := s.shareCommon [1, 2]
+let (y₁, _) := s.shareCommon ([0, 1].map (· + 1))
+let (y₂, _) := s.shareCommon ([0, 1].map (· + 1))
+unless ptrAddrUnsafe x == ptrAddrUnsafe y₁ && ptrAddrUnsafe x == ptrAddrUnsafe y₂ do
+  throw $ IO.userError "check failed"
+IO.println y₂
+
+/-- info: [1, 2] -/
+#guard_msgs in
+#eval tst3
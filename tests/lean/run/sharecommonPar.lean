@@ -0,0 +1,32 @@
+@[noinline] def mkEntry (i : Nat) : List Nat × String :=
+  (List.range (i % 50 + 1), toString (i % 7))
+
+def mkInput (n : Nat) : Array (List Nat × String) := Id.run do
+  let mut xs := #[]
+  for i in [0:n] do
+    xs := xs.push (mkEntry i)
+  return xs
+
+/-- Large enough to be processed in parallel. -/
+unsafe def tst (n : Nat) : IO Unit := do
+  let xs := mkInput n
+  let ys := ShareCommon.shareCommonPar' xs
+  let zs := ShareCommon.shareCommon' xs
+  unless xs == ys do throw $ IO.userError "value changed"
+  for i in [0:n] do
+    let j := i % 350
+    let k := (i + 1) % n
+    -- Equal entries are shared, and the sharing is the same as the one produced sequentially
+    unless ptrAddrUnsafe ys[i]! == ptrAddrUnsafe ys[j]! &&
+           ptrAddrUnsafe ys[i]!.2 == ptrAddrUnsafe ys[i % 7]!.2 &&
+           (ptrAddrUnsafe ys[i]! == ptrAddrUnsafe ys[k]!) == (ptrAddrUnsafe zs[i]! == ptrAddrUnsafe zs[k]!) do
+      throw $ IO.userError s!"check failed at {i}"
+  IO.println ys[n-1]!
+
+/-- info: ([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49], 0) -/
+#guard_msgs in
+#eval tst 20000
+
+/-- info: ([0, 1, 2], 2) -/
+#guard_msgs in
+#eval tst 3
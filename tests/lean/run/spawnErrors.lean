@@ -0,0 +1,33 @@
+/-!
+Spawning a missing program or using a missing working directory must fail with an IO error naming
+the program, both with `posix_spawn` and with the `fork` fallback (used when `PATH` is modified).
+-/
+
+def spawnError (cfg : IO.Process.SpawnArgs) : IO String := do
+  try
+    let child ← IO.Process.spawn cfg
+    let _ ← child.wait
+    return "no error"
+  catch e =>
+    return toString e
+
+def check (cfg : IO.Process.SpawnArgs) : IO Unit := do
+  let msg ← spawnError cfg
+  unless (msg.splitOn cfg.cmd).length > 1 do
+    throw <| IO.userError s!"unexpected error message: {msg}"
+
+#eval check { cmd := "lean-missing-program" }
+#eval check { cmd := "lean-missing-program", env := #[("PATH", some "/nonexistent")] }
+#eval check { cmd := "sh", args := #["-c", "true"], cwd := "/nonexistent", env := #[("PATH", some "/bin:/usr/bin")] }
+
+/-! Duplicate entries in `env`: the last one wins, as with `setenv`. -/
+
+def envOutput (env : Array (String × Option String)) : IO String := do
+  let out ← IO.Process.output { cmd := "sh", args := #["-c", "echo ${LEAN_TEST_VAR-unset}"], env }
+  return out.stdout.trim
+
+#eval do
+  let r ← envOutput #[("LEAN_TEST_VAR", some "a"), ("LEAN_TEST_VAR", some "b")]
+  unless r == "b" do throw <| IO.userError r
+  let r ← envOutput #[("LEAN_TEST_VAR", some "a"), ("LEAN_TEST_VAR", none)]
+  unless r == "unset" do throw <| IO.userError r
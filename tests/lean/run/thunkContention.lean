@@ -0,0 +1,26 @@
+def assertBEq [BEq α] [ToString α] (caption : String) (actual expected : α) : IO Unit := do
+  unless actual == expected do
+    throw <| IO.userError <|
+      s!"{caption}: expected '{expected}', got '{actual}'"
+
+def slowSum (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for i in [0:n] do
+    s := s + i
+  return s
+
+unsafe def mkCountingThunk (counter : IO.Ref Nat) (n : Nat) : Thunk Nat :=
+  Thunk.mk fun _ => unsafeBaseIO do
+    counter.modify (· + 1)
+    return slowSum n
+
+/-- Many tasks force the same thunk: it must be evaluated exactly once. -/
+unsafe def test : IO Unit := do
+  let counter ← IO.mkRef 0
+  let t := mkCountingThunk counter 1000000
+  let tasks := (List.range 32).map fun _ => Task.spawn fun _ => t.get
+  for task in tasks do
+    assertBEq "value" task.get (slowSum 1000000)
+  assertBEq "evaluations" (← counter.get) 1
+
+#eval test
@@ -0,0 +1,16 @@
+def test (n : Nat) : IO Unit := do
+  let fname : System.FilePath := "writeMany.tmp"
+  let ss := (Array.range n).map fun i => s!"line {i} λ\n"
+  IO.FS.withFile fname .write fun h => do
+    h.putStr "header\n"
+    h.putStrMany ss
+    h.writeMany (ss.map String.toUTF8)
+    h.putStr "footer\n"
+  let expected := "header\n" ++ String.join ss.toList ++ String.join ss.toList ++ "footer\n"
+  unless (← IO.FS.readFile fname) == expected do
+    throw <| IO.userError s!"unexpected contents for {n} strings"
+  IO.FS.removeFile fname
+
+-- small outputs go through the stdio buffer, large ones use `writev`
+#eval test 10
+#eval test 100000